@@ -0,0 +1,250 @@
+/*--------------------------------------------------------------------*/
+/* bench.c                                                            */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+#include "perf.h"
+
+/* The state of the xorshift pseudo-random number generator. */
+static unsigned long rngState = 1;
+
+/* TRUE if the report is being printed as JSON. */
+static boolean isJSON = FALSE;
+
+/* The number of JSON rows printed so far. */
+static size_t rows = 0;
+
+/* The engine and run that the rows being printed belong to. */
+static const char *groupEngine = "";
+static size_t groupRun = 0;
+
+/* TRUE if the hardware counters are open. */
+static boolean areCountersOn = FALSE;
+
+/* TRUE if Bench_startPhase has counted a phase that no row has
+   reported yet. */
+static boolean isPhasePending = FALSE;
+
+/* see bench.h for specification */
+size_t Bench_now(void) {
+   struct timespec now;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+   return (size_t) now.tv_sec * 1000000000 + (size_t) now.tv_nsec;
+}
+
+/* see bench.h for specification */
+unsigned long Bench_randomFrom(unsigned long *pState) {
+   assert(pState != NULL);
+
+   *pState ^= *pState << 13;
+   *pState ^= *pState >> 7;
+   *pState ^= *pState << 17;
+   return *pState;
+}
+
+/* see bench.h for specification */
+void Bench_seedState(unsigned long *pState, unsigned long seed) {
+   assert(pState != NULL);
+
+   *pState = seed * 2654435761UL + 1;
+   (void) Bench_randomFrom(pState);
+}
+
+/* see bench.h for specification */
+unsigned long Bench_random(void) {
+   return Bench_randomFrom(&rngState);
+}
+
+/* see bench.h for specification */
+void Bench_seed(unsigned long seed) {
+   Bench_seedState(&rngState, seed);
+}
+
+/* see bench.h for specification */
+size_t *Bench_newSizes(size_t n) {
+   size_t *sizes = malloc((n == 0 ? 1 : n) * sizeof(size_t));
+
+   if(sizes == NULL) {
+      fprintf(stderr, "bench: out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   return sizes;
+}
+
+/* Compares the size_t values that pv1 and pv2 point to, for qsort. */
+static int Bench_compareSizes(const void *pv1, const void *pv2) {
+   size_t s1 = *(const size_t*) pv1;
+   size_t s2 = *(const size_t*) pv2;
+
+   if(s1 < s2)
+      return -1;
+   return s1 > s2;
+}
+
+/* see bench.h for specification */
+void Bench_sortSizes(size_t *sizes, size_t n) {
+   assert(sizes != NULL);
+
+   qsort(sizes, n, sizeof(size_t), Bench_compareSizes);
+}
+
+/* see bench.h for specification */
+size_t Bench_percentile(const size_t *sizes, size_t n, double quantile) {
+   size_t rank;
+
+   assert(sizes != NULL);
+   assert(n > 0);
+
+   rank = (size_t) (quantile * (double) n);
+   if(rank >= n)
+      rank = n - 1;
+   return sizes[rank];
+}
+
+/* see bench.h for specification */
+void Bench_beginReport(boolean asJSON) {
+   isJSON = asJSON;
+   rows = 0;
+   if(isJSON)
+      printf("{\n\"results\": [");
+}
+
+/* see bench.h for specification */
+void Bench_beginGroup(const char *engine, size_t run, size_t runs) {
+   assert(engine != NULL);
+   assert(run < runs);
+
+   groupEngine = engine;
+   groupRun = run;
+   if(isJSON)
+      return;
+   if(runs == 1)
+      printf("engine: %s\n", engine);
+   else
+      printf("engine: %s (run %lu of %lu)\n", engine,
+             (unsigned long) run + 1, (unsigned long) runs);
+}
+
+/* see bench.h for specification */
+void Bench_printHeader(const char *label) {
+   assert(label != NULL);
+
+   if(isJSON)
+      return;
+   printf("%-18s %10s %12s %9s %9s %9s %9s %11s\n", label, "ops",
+          "ops/sec", "p50 ns", "p90 ns", "p99 ns", "p999 ns", "max ns");
+}
+
+/* see bench.h for specification */
+boolean Bench_enableCounters(void) {
+   int error;
+
+   if(Perf_open(&error) == 0) {
+      fprintf(stderr, "bench: no hardware counters (%s); "
+              "running uncounted\n", strerror(error));
+      return FALSE;
+   }
+   areCountersOn = TRUE;
+   return TRUE;
+}
+
+/* see bench.h for specification */
+size_t Bench_startPhase(void) {
+   if(areCountersOn) {
+      isPhasePending = TRUE;
+      Perf_start();
+   }
+   return Bench_now();
+}
+
+/* Prints the hardware events per operation of the pending phase,
+   which had ops operations, as the rest of the JSON row being printed
+   or as a line of text, and ends the phase. Prints nothing if no
+   phase is pending. */
+static void Bench_reportCounters(size_t ops) {
+   double counts[PERF_NUM_EVENTS];
+   int event;
+
+   if(!isPhasePending)
+      return;
+   isPhasePending = FALSE;
+   (void) Perf_read(counts);
+
+   if(!isJSON)
+      printf("%-18s", "  per op:");
+   for(event = 0; event < PERF_NUM_EVENTS; event++) {
+      if(counts[event] < 0)
+         continue;
+      if(isJSON)
+         printf(", \"%s\": %.3f", Perf_getName(event),
+                counts[event] / (double) ops);
+      else
+         printf(" %.1f %s", counts[event] / (double) ops,
+                Perf_getName(event));
+   }
+   if(!isJSON)
+      printf("\n");
+}
+
+/* see bench.h for specification */
+void Bench_report(const char *name, size_t *latencies, size_t ops,
+                  size_t totalNs) {
+   assert(name != NULL);
+   assert(latencies != NULL);
+
+   if(ops == 0) {
+      isPhasePending = FALSE;
+      return;
+   }
+   if(totalNs == 0)
+      totalNs = 1;
+
+   Bench_sortSizes(latencies, ops);
+   if(isJSON) {
+      printf("%s\n{\"engine\": \"%s\", \"run\": %lu, \"name\": \"%s\", "
+             "\"ops\": %lu, \"opsPerSec\": %.1f, \"p50\": %lu, "
+             "\"p90\": %lu, \"p99\": %lu, \"p999\": %lu, "
+             "\"max\": %lu",
+             rows == 0 ? "" : ",", groupEngine,
+             (unsigned long) groupRun, name, (unsigned long) ops,
+             (double) ops * 1e9 / (double) totalNs,
+             (unsigned long) Bench_percentile(latencies, ops, 0.5),
+             (unsigned long) Bench_percentile(latencies, ops, 0.9),
+             (unsigned long) Bench_percentile(latencies, ops, 0.99),
+             (unsigned long) Bench_percentile(latencies, ops, 0.999),
+             (unsigned long) latencies[ops - 1]);
+      Bench_reportCounters(ops);
+      printf("}");
+      rows++;
+      return;
+   }
+   printf("%-18s %10lu %12.0f %9lu %9lu %9lu %9lu %11lu\n", name,
+          (unsigned long) ops, (double) ops * 1e9 / (double) totalNs,
+          (unsigned long) Bench_percentile(latencies, ops, 0.5),
+          (unsigned long) Bench_percentile(latencies, ops, 0.9),
+          (unsigned long) Bench_percentile(latencies, ops, 0.99),
+          (unsigned long) Bench_percentile(latencies, ops, 0.999),
+          (unsigned long) latencies[ops - 1]);
+   Bench_reportCounters(ops);
+}
+
+/* see bench.h for specification */
+void Bench_endReport(long peakKiB) {
+   if(isJSON) {
+      printf("\n]");
+      if(peakKiB >= 0)
+         printf(",\n\"peakRssKiB\": %ld", peakKiB);
+      printf("\n}\n");
+   }
+   else if(peakKiB >= 0)
+      printf("peak RSS: %ld KiB\n", peakKiB);
+}
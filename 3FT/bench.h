@@ -0,0 +1,89 @@
+/*--------------------------------------------------------------------*/
+/* bench.h                                                            */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef BENCH_INCLUDED
+#define BENCH_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/* Helpers shared by the benchmark programs: a monotonic clock, a
+   seedable pseudo-random number generator, and latency summaries. */
+
+/* Returns the current time of a monotonic clock, in ns. */
+size_t Bench_now(void);
+
+/* Restarts the pseudo-random sequence from seed, so that runs with the
+   same seed see the same numbers. */
+void Bench_seed(unsigned long seed);
+
+/* Returns the next pseudo-random number of the xorshift generator. */
+unsigned long Bench_random(void);
+
+/* Sets the state *pState of a separate xorshift generator, such as a
+   thread's own, to start its sequence from seed. */
+void Bench_seedState(unsigned long *pState, unsigned long seed);
+
+/* Returns the next pseudo-random number of the xorshift generator
+   whose state is *pState. */
+unsigned long Bench_randomFrom(unsigned long *pState);
+
+/* Returns a new array of n size_t values, exiting the program if there
+   is no memory for it. */
+size_t *Bench_newSizes(size_t n);
+
+/* Sorts the array sizes of length n into ascending order. */
+void Bench_sortSizes(size_t *sizes, size_t n);
+
+/* Returns the value at quantile (between 0 and 1) of the ascending
+   array sizes of length n, which must not be 0. */
+size_t Bench_percentile(const size_t *sizes, size_t n, double quantile);
+
+/* Makes the report functions below print one JSON document, if asJSON
+   is TRUE, instead of text tables, and starts that document. The
+   document is an object whose "results" array holds one object per
+   Bench_report row, each on a line of its own, with the members
+   "engine", "run", "name", "ops", "opsPerSec", "p50", "p90", "p99",
+   "p999" and "max" (latencies in ns), and the hardware events per
+   operation of the phases that were counted; ft_benchcmp reads it. */
+void Bench_beginReport(boolean asJSON);
+
+/* Starts the rows of run run (from 0) of runs on the engine named
+   engine: prints a line naming them in text, or labels the rows that
+   follow with them in JSON. */
+void Bench_beginGroup(const char *engine, size_t run, size_t runs);
+
+/* Prints the column headings of the report that Bench_report prints
+   the rows of, headed by label. Prints nothing in JSON. */
+void Bench_printHeader(const char *label);
+
+/* Opens the hardware counters of the perf module (see perf.h) for the
+   calling thread, so that the phases that Bench_startPhase starts
+   from then on are counted. Returns TRUE, or FALSE (after writing why
+   to stderr) if no counter can be opened, in which case the phases
+   run uncounted. */
+boolean Bench_enableCounters(void);
+
+/* Starts a phase whose operations are all of one kind: zeroes and
+   starts the hardware counters, if they are enabled, so that the next
+   Bench_report row also gives the events per operation of the phase.
+   Returns the current time of the clock of Bench_now. */
+size_t Bench_startPhase(void);
+
+/* Prints the throughput and latency distribution of the ops
+   operations of the phase named name, whose latencies in ns are in
+   latencies (which this sorts), and which took totalNs in all. If
+   Bench_startPhase started a phase that no row has reported yet, also
+   prints the hardware events per operation of that phase: on a line
+   of its own in text, and as members named by Perf_getName in JSON.
+   Prints nothing if ops is 0. */
+void Bench_report(const char *name, size_t *latencies, size_t ops,
+                  size_t totalNs);
+
+/* Ends the report with the peak resident set size of the process,
+   peakKiB, or leaves that out if peakKiB is negative. */
+void Bench_endReport(long peakKiB);
+
+#endif
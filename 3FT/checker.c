@@ -3,12 +3,43 @@
 /* Author:                                                            */
 /*--------------------------------------------------------------------*/
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "dynarray.h"
 #include "checker.h"
 
+/* Trees with fewer Nodes than this are validated on the calling
+   thread, since spawning workers would cost more than it saves. */
+enum { PARALLEL_THRESHOLD = 4096 };
+
+/* The upper bound on the number of worker threads used to validate
+   subtrees concurrently. */
+enum { MAX_WORKERS = 64 };
+
+/* The number of subtrees handed out per worker, so that workers that
+   finish early can pick up the remaining work. */
+enum { SUBTREES_PER_WORKER = 8 };
+
+/* The shared state of a parallel validation: the subtrees still to be
+   checked, and the reduction of the workers' results. */
+struct checkerWork {
+   /* the roots of the subtrees to validate */
+   DynArray_T subtrees;
+   /* the index of the next subtree to hand out */
+   size_t next;
+   /* the sum of the Nodes counted by every finished worker */
+   size_t count;
+   /* FALSE once any worker has found a broken invariant */
+   boolean isValid;
+   /* guards next, count and isValid */
+   pthread_mutex_t lock;
+};
+
 
 /* see checker.h for specification */
 static boolean Checker_Node_isValid(Node n) {
@@ -71,57 +102,238 @@ static boolean Checker_Node_isValid(Node n) {
 }
 
 /*
-   Performs a pre-order traversal of the tree rooted at n.
-   Returns FALSE if a broken invariant is found and
-   returns TRUE otherwise.
-
-   You may want to change this function's return type or
-   parameter list to facilitate constructing your checks.
-   If you do, you should update this function comment.
+   Checks the invariants that relate n to its direct children: every
+   child must store n as its parent and be found under its name by the
+   engine, and the children must be stored in strictly increasing
+   order (files before directories, then by path), which also rules
+   out duplicate children.
+   Returns FALSE if a broken invariant is found and TRUE otherwise.
 */
-static boolean Checker_treeCheck(Node n) {
+static boolean Checker_childrenCheck(Node n) {
    size_t c;
-   char *previousPath;
-   if(n != NULL) {
+   Node child;
+   Node previous = NULL;
 
-      /* Sample check on each non-root Node: Node must be valid */
-      /* If not, pass that failure back up immediately */
-      if(!Checker_Node_isValid(n))
+   assert(n != NULL);
+
+   for(c = 0; c < Node_getNumChildren(n); c++) {
+      child = Node_getChild(n, c);
+      if(child == NULL) {
+         fprintf(stderr, "Node is missing a child\n");
          return FALSE;
+      }
 
+      if(previous != NULL && Node_compare(previous, child) >= 0) {
+         fprintf(stderr, "Children are incorrectly ordered\n");
+         return FALSE;
+      }
+      previous = child;
 
-      for(c = 0; c < Node_getNumChildren(n); c++)
-      {
-         Node child = Node_getChild(n, c);
-         if(c == 0){
-            previousPath = (char*) Node_getPath(child);
-         }
-         /*
-         else{
-            if(strcmp((const char*)previousPath,
-                      Node_getPath(child)) >= 0){
-                  fprintf(stderr, "Children are incorrectly ordered\n");
-                  return FALSE;
-            }
-            } */
-
-         /* if recurring down one subtree results in a failed check
-            farther down, passes the failure back up immediately */
-         if(!Checker_treeCheck(child))
-            return FALSE;
-
-         if(strcmp(Node_getPath(Node_getParent(child)),
-                      Node_getPath(n)) != 0){
-               fprintf(stderr, "Child's stored parent is wrong\n");
-               return FALSE;
-         }
+      if(Node_getParent(child) != n) {
+         fprintf(stderr, "Child's stored parent is wrong\n");
+         return FALSE;
+      }
+
+      if(Node_findChild(n, Node_isFile(child), Node_getName(child),
+                        Node_getNameLength(child)) != child) {
+         fprintf(stderr, "Child cannot be found by its name\n");
+         return FALSE;
       }
    }
+
+   return TRUE;
+}
+
+/* The state of one call to Checker_treeCheck's traversal. */
+struct checkerWalk {
+   /* the number of Nodes found valid so far */
+   size_t count;
+   /* FALSE once a broken invariant has been found */
+   boolean isValid;
+};
+
+/*
+   Checks Node n and its children, counting n in *pvWalk, a struct
+   checkerWalk, if they are valid. Returns TRUE if they are, and
+   otherwise records the failure and returns FALSE, which ends the
+   traversal.
+*/
+static boolean Checker_visit(Node n, void* pvWalk) {
+   struct checkerWalk* pWalk = pvWalk;
+
+   assert(pWalk != NULL);
+
+   /* Sample check on each non-root Node: Node must be valid */
+   /* If not, pass that failure back up immediately */
+   if(!Checker_Node_isValid(n) || !Checker_childrenCheck(n)) {
+      pWalk->isValid = FALSE;
+      return FALSE;
+   }
+   pWalk->count++;
    return TRUE;
 }
 
+/*
+   Performs a pre-order traversal of the tree rooted at n, adding the
+   number of Nodes visited to *pCount. The traversal keeps its stack on
+   the heap, so trees of any depth can be checked.
+   Returns FALSE if a broken invariant is found, or if there is not
+   enough memory for the traversal, and returns TRUE otherwise.
+*/
+static boolean Checker_treeCheck(Node n, size_t* pCount) {
+   struct checkerWalk walk;
+
+   assert(pCount != NULL);
+
+   if(n == NULL)
+      return TRUE;
+
+   walk.count = 0;
+   walk.isValid = TRUE;
+   if(Node_preOrder(n, Checker_visit, &walk) != SUCCESS) {
+      fprintf(stderr, "Not enough memory to check the tree\n");
+      return FALSE;
+   }
+   *pCount += walk.count;
+   return walk.isValid;
+}
+
+/*
+   Repeatedly takes the next unclaimed subtree from the
+   struct checkerWork pointed to by pvWork and validates it, until no
+   subtrees remain or another worker has found a broken invariant.
+   Folds this worker's Node count and result into the shared state
+   once it is done. Returns NULL.
+*/
+static void* Checker_worker(void* pvWork) {
+   struct checkerWork* work = pvWork;
+   size_t localCount = 0;
+   boolean localValid = TRUE;
+   Node subtree;
+
+   assert(work != NULL);
+
+   while(localValid) {
+      (void) pthread_mutex_lock(&work->lock);
+      if(!work->isValid ||
+         work->next == DynArray_getLength(work->subtrees))
+         subtree = NULL;
+      else
+         subtree = DynArray_get(work->subtrees, work->next++);
+      (void) pthread_mutex_unlock(&work->lock);
+
+      if(subtree == NULL)
+         break;
+      localValid = Checker_treeCheck(subtree, &localCount);
+   }
+
+   (void) pthread_mutex_lock(&work->lock);
+   work->count += localCount;
+   if(!localValid)
+      work->isValid = FALSE;
+   (void) pthread_mutex_unlock(&work->lock);
+
+   return NULL;
+}
+
+/*
+   Returns the number of worker threads to validate with, based on
+   the number of online processors.
+*/
+static size_t Checker_numWorkers(void) {
+   long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+   if(online < 1)
+      return 1;
+   if(online > MAX_WORKERS)
+      return MAX_WORKERS;
+   return (size_t) online;
+}
+
+/*
+   Validates the tree rooted at root across a pool of worker threads,
+   adding the number of Nodes in it to *pCount. The top levels of the
+   tree are checked on the calling thread, breadth-first, until there
+   are enough disjoint subtrees to keep every worker busy; the workers
+   then validate those subtrees concurrently and their per-worker
+   counts are summed. Falls back to a serial check if the workers
+   cannot be started.
+   Returns FALSE if a broken invariant is found and TRUE otherwise.
+*/
+static boolean Checker_parallelTreeCheck(Node root, size_t* pCount) {
+   struct checkerWork work;
+   pthread_t workers[MAX_WORKERS];
+   size_t numWorkers;
+   size_t started;
+   size_t w;
+   size_t c;
+   Node n;
+
+   assert(root != NULL);
+   assert(pCount != NULL);
+
+   numWorkers = Checker_numWorkers();
+
+   work.subtrees = DynArray_new(0);
+   if(work.subtrees == NULL)
+      return Checker_treeCheck(root, pCount);
+   if(!DynArray_add(work.subtrees, root)) {
+      DynArray_free(work.subtrees);
+      return Checker_treeCheck(root, pCount);
+   }
+
+   /* Split the tree: replace the first Node in the frontier by its
+      children until the frontier is wide enough or only leaves
+      remain. Nodes taken out of the frontier are checked here. */
+   work.next = 0;
+   while(work.next < DynArray_getLength(work.subtrees) &&
+         DynArray_getLength(work.subtrees) - work.next
+            < numWorkers * SUBTREES_PER_WORKER) {
+      n = DynArray_get(work.subtrees, work.next);
+      if(!Checker_Node_isValid(n) || !Checker_childrenCheck(n)) {
+         DynArray_free(work.subtrees);
+         return FALSE;
+      }
+      for(c = 0; c < Node_getNumChildren(n); c++)
+         if(!DynArray_add(work.subtrees, Node_getChild(n, c))) {
+            DynArray_free(work.subtrees);
+            return Checker_treeCheck(root, pCount);
+         }
+      work.next++;
+   }
+
+   if(pthread_mutex_init(&work.lock, NULL) != 0) {
+      DynArray_free(work.subtrees);
+      return Checker_treeCheck(root, pCount);
+   }
+   /* Every Node taken out of the frontier has been counted. */
+   work.count = work.next;
+   work.isValid = TRUE;
+
+   if(numWorkers > DynArray_getLength(work.subtrees) - work.next)
+      numWorkers = DynArray_getLength(work.subtrees) - work.next;
+   for(started = 0; started + 1 < numWorkers; started++)
+      if(pthread_create(&workers[started], NULL, Checker_worker,
+                        &work) != 0)
+         break;
+
+   /* The calling thread is a worker as well, which also guarantees
+      progress if no other worker could be started. */
+   (void) Checker_worker(&work);
+   for(w = 0; w < started; w++)
+      (void) pthread_join(workers[w], NULL);
+
+   (void) pthread_mutex_destroy(&work.lock);
+   DynArray_free(work.subtrees);
+
+   *pCount += work.count;
+   return work.isValid;
+}
+
 /* see checker.h for specification */
 boolean Checker_FT_isValid(boolean isInit, Node root, size_t count) {
+   size_t actualCount = 0;
+   boolean result;
 
    /* Sample check on a top-level data structure invariant:
       if the DT is not initialized, its count should be 0. */
@@ -135,16 +347,34 @@ boolean Checker_FT_isValid(boolean isInit, Node root, size_t count) {
          return FALSE;
       }
    }
-   /* else{
-      if(count == 0) {
+   else{
+      /* Removing the root leaves an initialized but empty tree, so
+         the count must be 0 exactly when there is no root. */
+      if(root == NULL && count != 0) {
          fprintf(stderr, "Initialized, but incorrect # of nodes\n");
          return FALSE;
       }
-      if(root == NULL){
+      if(root != NULL && count == 0){
          fprintf(stderr, "Initialized but has no root\n");
          return FALSE;
       }
-      }*/
-   /* Now checks invariants recursively at each Node from the root. */
-   return Checker_treeCheck(root);
+   }
+
+   if(root == NULL)
+      return TRUE;
+
+   /* Now checks invariants at each Node from the root. */
+   if(count < PARALLEL_THRESHOLD)
+      result = Checker_treeCheck(root, &actualCount);
+   else
+      result = Checker_parallelTreeCheck(root, &actualCount);
+   if(!result)
+      return FALSE;
+
+   if(actualCount != count) {
+      fprintf(stderr, "Count does not match the # of nodes\n");
+      return FALSE;
+   }
+
+   return TRUE;
 }
@@ -14,6 +14,10 @@
    isInit indicating whether it has been initialized, a Node root
    representing the root of the hierarchy, and a size_t count
    representing the total number of directories in the hierarchy.
+
+   Large hierarchies are validated by a pool of worker threads, one
+   subtree at a time, with the per-worker node counts summed and
+   compared against count at the end.
 */
 boolean Checker_FT_isValid(boolean isInit, Node root, size_t count);
 
@@ -0,0 +1,698 @@
+/*--------------------------------------------------------------------*/
+/* children.c                                                         */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "children.h"
+#include "path.h"
+#include "stats.h"
+
+/* The number of child slots a flat array starts with once it is first
+   used; it doubles from there up to CHILDREN_CHUNK. */
+enum { FIRST_SLOTS = 4 };
+
+/* The number of chunks the chunk directory starts with when a flat
+   array first splits. */
+enum { FIRST_CHUNKS = 4 };
+
+/* A chunk with fewer children than this merges with a neighbour, if
+   the two fit in MERGED_MAX children. */
+enum { MERGE_BELOW = CHILDREN_CHUNK / 4 };
+enum { MERGED_MAX = CHILDREN_CHUNK / 4 * 3 };
+
+/* The number of leading bytes of a name that its key holds. */
+enum { KEY_BYTES = sizeof(unsigned long) };
+
+/* The number of keys, or of Nodes, in a 64-byte cache line, and the
+   most children whose every slot Children_prefetch loads. */
+enum { LINE_SLOTS = 64 / sizeof(unsigned long) };
+enum { PREFETCH_ALL = 4 * LINE_SLOTS };
+
+/* The number of children of one type at which a Children_T that is
+   filtered builds its Bloom filter, and below half of which it drops
+   it again. */
+enum { FILTER_MIN = CHILDREN_CHUNK };
+
+/* The bits of filter per child that a filter is sized for, and the
+   number of bits of its word that each name sets. */
+enum { FILTER_BITS_PER_CHILD = 16 };
+enum { FILTER_PROBES = 4 };
+
+/* The number of bits in a word of a filter. */
+enum { FILTER_WORD_BITS = sizeof(unsigned long) * CHAR_BIT };
+
+/* The size of one child slot: its key and its Node. */
+#define SLOT_SIZE (sizeof(unsigned long) + sizeof(Node))
+
+/*
+   A run of consecutive children. Each child has a key, which packs
+   the first KEY_BYTES bytes of its name (padded with '\0') into one
+   unsigned long that orders as the child does. The keys are kept in
+   an array of their own, in the same block as the array of Nodes, so
+   that a binary search reads a few cache lines of keys and looks at a
+   Node and its name only to break a tie between names that share
+   their first KEY_BYTES bytes.
+*/
+struct chunk {
+   /* the identifier of the first child in this chunk */
+   size_t start;
+   /* the number of children in this chunk */
+   size_t length;
+   /* the number of slots in keys and nodes: up to CHILDREN_CHUNK
+      while the directory is flat, and exactly CHILDREN_CHUNK once it
+      is not */
+   size_t capacity;
+   /* the children's keys, in a block that also holds nodes, or NULL
+      while capacity is 0 */
+   unsigned long* keys;
+   /* the children, just past the capacity slots of keys */
+   Node* nodes;
+};
+
+/*
+   The children of one type of a directory: one chunk, stored in
+   flat, while the directory is flat, and otherwise a directory of
+   chunks in order, none of them empty.
+
+   A Children_T that is filtered keeps, once it has FILTER_MIN
+   children, a blocked Bloom filter of their names: each name sets
+   FILTER_PROBES bits of one word, chosen by a hash of the name, so
+   that a test reads one word, and a name none of whose bits are all
+   set is not a child. Insertions add to the filter. Removals leave
+   their bits behind, which only makes the filter answer "maybe" more
+   often, and it is rebuilt from the children at the next insertion
+   once more than half as many children as are left have been removed
+   since it was built, or once more children than it was sized for
+   are in it.
+*/
+struct children {
+   /* the number of children */
+   size_t length;
+   /* the number of chunks in use */
+   size_t numChunks;
+   /* the number of chunks that chunks can hold, or 0 while flat */
+   size_t maxChunks;
+   /* the chunks: &flat while flat, and otherwise an array */
+   struct chunk* chunks;
+   /* the only chunk while flat */
+   struct chunk flat;
+   /* TRUE if a filter is kept once there are FILTER_MIN children */
+   boolean isFiltered;
+   /* the Bloom filter of the children's names, or NULL if there is
+      none */
+   unsigned long* filter;
+   /* the number of words in filter, a power of two */
+   size_t filterWords;
+   /* the number of children that filter was sized for */
+   size_t filterCapacity;
+   /* the number of children removed since filter was built */
+   size_t filterRemoved;
+};
+
+/*
+   Returns the key of a child named by the length bytes at name: the
+   first KEY_BYTES bytes of the name, most significant first, padded
+   with '\0'.
+*/
+static unsigned long Children_key(const char* name, size_t length) {
+   unsigned long key = 0;
+   size_t i;
+
+   for(i = 0; i < KEY_BYTES; i++)
+      key = key << CHAR_BIT |
+            (i < length ? (unsigned char) name[i] : 0);
+   return key;
+}
+
+/*
+   Compares the child in slot i of chunk with the child named by the
+   length bytes at name, whose key is key, in the order of
+   Children_T.
+*/
+static int Children_compare(const struct chunk* chunk, size_t i,
+                            unsigned long key, const char* name,
+                            size_t length) {
+   Node child;
+
+   STATS_ADD(nodeCompares, 1);
+
+   if(chunk->keys[i] != key)
+      return chunk->keys[i] < key ? -1 : 1;
+   /* a name that ends within the key is all in it */
+   if((key & UCHAR_MAX) == 0)
+      return 0;
+
+   /* otherwise both names fill the key, and the rest decides */
+   child = chunk->nodes[i];
+   return Path_compare(Node_getName(child) + KEY_BYTES,
+                       Node_getNameLength(child) - KEY_BYTES,
+                       name + KEY_BYTES, length - KEY_BYTES);
+}
+
+/*
+   Moves count slots, keys and Nodes both, from slot from of chunk src
+   to slot to of chunk dst, which may be the same chunk.
+*/
+static void Children_moveSlots(struct chunk* dst, size_t to,
+                               const struct chunk* src, size_t from,
+                               size_t count) {
+   memmove(&dst->keys[to], &src->keys[from],
+           count * sizeof(unsigned long));
+   memmove(&dst->nodes[to], &src->nodes[from], count * sizeof(Node));
+   STATS_ADD(memmovedBytes, count * SLOT_SIZE);
+}
+
+/*
+   Returns 32 well-mixed bits of hash, with the finalizer of
+   MurmurHash3.
+*/
+static unsigned long Children_mix(unsigned long hash) {
+   hash &= 0xffffffffUL;
+   hash ^= hash >> 16;
+   hash = (hash * 0x85ebca6bUL) & 0xffffffffUL;
+   hash ^= hash >> 13;
+   hash = (hash * 0xc2b2ae35UL) & 0xffffffffUL;
+   hash ^= hash >> 16;
+   return hash;
+}
+
+/*
+   Returns the FNV-1a hash of the length bytes at name.
+*/
+static unsigned long Children_hashName(const char* name,
+                                       size_t length) {
+   unsigned long hash = 2166136261UL;
+   size_t i;
+
+   for(i = 0; i < length; i++) {
+      hash ^= (unsigned char) name[i];
+      hash *= 16777619UL;
+   }
+   return hash;
+}
+
+/*
+   Returns the word of the filter of oChildren for a name whose hash
+   is hash, and stores in *pBits the bits of it that the name sets.
+*/
+static unsigned long* Children_filterWord(Children_T oChildren,
+                                          unsigned long hash,
+                                          unsigned long* pBits) {
+   unsigned long probes = Children_mix(hash ^ 0x9e3779b9UL);
+   size_t i;
+
+   *pBits = 0;
+   for(i = 0; i < FILTER_PROBES; i++)
+      *pBits |= 1UL << ((probes >> (i * 8)) % FILTER_WORD_BITS);
+   return &oChildren->filter[Children_mix(hash)
+                             & (oChildren->filterWords - 1)];
+}
+
+/*
+   Adds child to the filter of oChildren, which must have one.
+*/
+static void Children_filterAdd(Children_T oChildren, Node child) {
+   unsigned long bits;
+   unsigned long* word =
+      Children_filterWord(oChildren,
+                          Children_hashName(Node_getName(child),
+                                            Node_getNameLength(child)),
+                          &bits);
+
+   *word |= bits;
+}
+
+/*
+   Frees the filter of oChildren, if it has one.
+*/
+static void Children_dropFilter(Children_T oChildren) {
+   if(oChildren->filter == NULL)
+      return;
+   free(oChildren->filter);
+   STATS_ADD(frees[FT_SUB_NODE], 1);
+   oChildren->filter = NULL;
+}
+
+/*
+   Builds the filter of oChildren afresh from its children, sized for
+   twice as many as it has, in place of the one it has, if any. Leaves
+   oChildren without a filter if there is not enough memory for it.
+*/
+static void Children_buildFilter(Children_T oChildren) {
+   const struct chunk* chunk;
+   size_t words = 1;
+   size_t k;
+   size_t i;
+
+   Children_dropFilter(oChildren);
+
+   while(words * FILTER_WORD_BITS
+         < 2 * oChildren->length * FILTER_BITS_PER_CHILD)
+      words *= 2;
+   oChildren->filter = calloc(words, sizeof(unsigned long));
+   if(oChildren->filter == NULL)
+      return;
+   STATS_ADD(mallocs[FT_SUB_NODE], 1);
+   oChildren->filterWords = words;
+   oChildren->filterCapacity =
+      words * FILTER_WORD_BITS / FILTER_BITS_PER_CHILD;
+   oChildren->filterRemoved = 0;
+
+   for(k = 0; k < oChildren->numChunks; k++) {
+      chunk = &oChildren->chunks[k];
+      for(i = 0; i < chunk->length; i++)
+         Children_filterAdd(oChildren, chunk->nodes[i]);
+   }
+}
+
+/* see children.h for specification */
+Children_T Children_new(boolean isFiltered) {
+   Children_T oChildren = malloc(sizeof(struct children));
+
+   if(oChildren == NULL)
+      return NULL;
+   STATS_ADD(mallocs[FT_SUB_NODE], 1);
+
+   oChildren->length = 0;
+   oChildren->numChunks = 1;
+   oChildren->maxChunks = 0;
+   oChildren->chunks = &oChildren->flat;
+   oChildren->flat.start = 0;
+   oChildren->flat.length = 0;
+   oChildren->flat.capacity = 0;
+   oChildren->flat.keys = NULL;
+   oChildren->flat.nodes = NULL;
+   oChildren->isFiltered = isFiltered;
+   oChildren->filter = NULL;
+   oChildren->filterWords = 0;
+   oChildren->filterCapacity = 0;
+   oChildren->filterRemoved = 0;
+   return oChildren;
+}
+
+/* see children.h for specification */
+void Children_free(Children_T oChildren) {
+   size_t k;
+
+   assert(oChildren != NULL);
+
+   for(k = 0; k < oChildren->numChunks; k++)
+      if(oChildren->chunks[k].keys != NULL) {
+         free(oChildren->chunks[k].keys);
+         STATS_ADD(frees[FT_SUB_NODE], 1);
+      }
+   if(oChildren->maxChunks != 0) {
+      free(oChildren->chunks);
+      STATS_ADD(frees[FT_SUB_NODE], 1);
+   }
+   Children_dropFilter(oChildren);
+   free(oChildren);
+   STATS_ADD(frees[FT_SUB_NODE], 1);
+}
+
+/* see children.h for specification */
+size_t Children_getLength(Children_T oChildren) {
+   assert(oChildren != NULL);
+
+   return oChildren->length;
+}
+
+/*
+   Returns the index of the chunk of oChildren that holds the child
+   with identifier childID, or, for a childID of
+   Children_getLength(oChildren), the last chunk.
+*/
+static size_t Children_findChunk(Children_T oChildren, size_t childID) {
+   size_t lo = 0;
+   size_t hi = oChildren->numChunks - 1;
+   size_t mid;
+
+   if(hi == 0 || childID >= oChildren->chunks[hi].start)
+      return hi;
+
+   /* Chunks tend to be about the same size, so first try the chunk
+      that childID would be in if they all were. */
+   mid = childID * oChildren->numChunks / oChildren->length;
+   if(oChildren->chunks[mid].start > childID)
+      hi = mid - 1;
+   else if(oChildren->chunks[mid].start + oChildren->chunks[mid].length
+             > childID)
+      return mid;
+   else
+      lo = mid + 1;
+
+   while(lo < hi) {
+      mid = lo + (hi - lo + 1) / 2;
+      if(oChildren->chunks[mid].start <= childID)
+         lo = mid;
+      else
+         hi = mid - 1;
+   }
+   return lo;
+}
+
+/* see children.h for specification */
+Node Children_get(Children_T oChildren, size_t childID) {
+   struct chunk* chunk;
+
+   assert(oChildren != NULL);
+   assert(childID < oChildren->length);
+
+   chunk = &oChildren->chunks[Children_findChunk(oChildren, childID)];
+   return chunk->nodes[childID - chunk->start];
+}
+
+/* see children.h for specification */
+boolean Children_search(Children_T oChildren, const char* name,
+                        size_t length, size_t* pChildID) {
+   unsigned long key;
+   struct chunk* chunk;
+   size_t lo = 0;
+   size_t hi = oChildren->numChunks - 1;
+   size_t mid;
+   int result;
+
+   assert(oChildren != NULL);
+   assert(name != NULL);
+   assert(pChildID != NULL);
+
+   key = Children_key(name, length);
+
+   /* find the last chunk whose first child is not after the name */
+   while(lo < hi) {
+      mid = lo + (hi - lo + 1) / 2;
+      if(Children_compare(&oChildren->chunks[mid], 0, key, name,
+                          length) <= 0)
+         lo = mid;
+      else
+         hi = mid - 1;
+   }
+   chunk = &oChildren->chunks[lo];
+
+   lo = 0;
+   hi = chunk->length;
+   while(lo < hi) {
+      mid = lo + (hi - lo) / 2;
+      result = Children_compare(chunk, mid, key, name, length);
+      if(result == 0) {
+         *pChildID = chunk->start + mid;
+         return TRUE;
+      }
+      if(result < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   *pChildID = chunk->start + lo;
+   return FALSE;
+}
+
+/* see children.h for specification */
+boolean Children_mayContain(Children_T oChildren, const char* name,
+                            size_t length) {
+   unsigned long bits;
+   unsigned long* word;
+
+   assert(oChildren != NULL);
+   assert(name != NULL);
+
+   if(oChildren->filter == NULL)
+      return TRUE;
+
+   word = Children_filterWord(oChildren,
+                              Children_hashName(name, length), &bits);
+   if((*word & bits) == bits)
+      return TRUE;
+   STATS_ADD(filterRejects, 1);
+   return FALSE;
+}
+
+/*
+   Gives the flat chunk of oChildren, which is full, twice its slots.
+   Returns TRUE, or FALSE if there is not enough memory, in which case
+   oChildren is unchanged.
+*/
+static boolean Children_growFlat(Children_T oChildren) {
+   struct chunk* flat = &oChildren->flat;
+   size_t capacity = flat->capacity == 0 ? FIRST_SLOTS
+                                         : flat->capacity * 2;
+   unsigned long* keys = realloc(flat->keys, capacity * SLOT_SIZE);
+
+   if(keys == NULL)
+      return FALSE;
+   if(flat->keys == NULL)
+      STATS_ADD(mallocs[FT_SUB_NODE], 1);
+
+   /* the Nodes follow the keys, which now take more room */
+   memmove(keys + capacity, keys + flat->capacity,
+           flat->length * sizeof(Node));
+   flat->keys = keys;
+   flat->nodes = (Node*) (keys + capacity);
+   flat->capacity = capacity;
+   return TRUE;
+}
+
+/*
+   Splits chunk k of oChildren, which is full, into two halves, making
+   room in the chunk directory for the new one (and creating that
+   directory, if oChildren is flat). Returns TRUE, or FALSE if there is
+   not enough memory, in which case oChildren is unchanged.
+*/
+static boolean Children_split(Children_T oChildren, size_t k) {
+   struct chunk* chunks = oChildren->chunks;
+   struct chunk* upper;
+   unsigned long* keys;
+   size_t half;
+
+   keys = malloc(CHILDREN_CHUNK * SLOT_SIZE);
+   if(keys == NULL)
+      return FALSE;
+
+   if(oChildren->maxChunks == 0) {
+      chunks = malloc(FIRST_CHUNKS * sizeof(struct chunk));
+      if(chunks == NULL) {
+         free(keys);
+         return FALSE;
+      }
+      STATS_ADD(mallocs[FT_SUB_NODE], 1);
+      chunks[0] = oChildren->flat;
+      oChildren->maxChunks = FIRST_CHUNKS;
+   }
+   else if(oChildren->numChunks == oChildren->maxChunks) {
+      chunks = realloc(chunks, 2 * oChildren->maxChunks
+                               * sizeof(struct chunk));
+      if(chunks == NULL) {
+         free(keys);
+         return FALSE;
+      }
+      oChildren->maxChunks *= 2;
+   }
+   STATS_ADD(mallocs[FT_SUB_NODE], 1);
+   oChildren->chunks = chunks;
+
+   memmove(&chunks[k + 2], &chunks[k + 1],
+           (oChildren->numChunks - k - 1) * sizeof(struct chunk));
+   oChildren->numChunks++;
+
+   half = chunks[k].length / 2;
+   upper = &chunks[k + 1];
+   upper->start = chunks[k].start + half;
+   upper->length = chunks[k].length - half;
+   upper->capacity = CHILDREN_CHUNK;
+   upper->keys = keys;
+   upper->nodes = (Node*) (keys + CHILDREN_CHUNK);
+   Children_moveSlots(upper, 0, &chunks[k], half, upper->length);
+   chunks[k].length = half;
+   return TRUE;
+}
+
+/* see children.h for specification */
+boolean Children_insertAt(Children_T oChildren, size_t childID,
+                          Node child) {
+   struct chunk* chunk;
+   size_t k;
+   size_t i;
+
+   assert(oChildren != NULL);
+   assert(childID <= oChildren->length);
+   assert(child != NULL);
+
+   k = Children_findChunk(oChildren, childID);
+   chunk = &oChildren->chunks[k];
+   if(chunk->length == chunk->capacity) {
+      if(chunk->capacity < CHILDREN_CHUNK) {
+         if(!Children_growFlat(oChildren))
+            return FALSE;
+      }
+      else {
+         if(!Children_split(oChildren, k))
+            return FALSE;
+         if(childID - oChildren->chunks[k].start
+               > oChildren->chunks[k].length)
+            k++;
+         chunk = &oChildren->chunks[k];
+      }
+   }
+
+   i = childID - chunk->start;
+   Children_moveSlots(chunk, i + 1, chunk, i, chunk->length - i);
+   chunk->keys[i] = Children_key(Node_getName(child),
+                                 Node_getNameLength(child));
+   chunk->nodes[i] = child;
+   chunk->length++;
+   for(k++; k < oChildren->numChunks; k++)
+      oChildren->chunks[k].start++;
+   oChildren->length++;
+
+   if(oChildren->filter != NULL &&
+      oChildren->length <= oChildren->filterCapacity &&
+      2 * oChildren->filterRemoved <= oChildren->length)
+      Children_filterAdd(oChildren, child);
+   else if(oChildren->filter != NULL ||
+           (oChildren->isFiltered && oChildren->length >= FILTER_MIN))
+      Children_buildFilter(oChildren);
+   return TRUE;
+}
+
+/*
+   Removes chunk k of oChildren from the chunk directory, after its
+   children have been moved elsewhere or removed, and makes oChildren
+   flat again if only one chunk is left.
+*/
+static void Children_dropChunk(Children_T oChildren, size_t k) {
+   struct chunk* chunks = oChildren->chunks;
+
+   free(chunks[k].keys);
+   STATS_ADD(frees[FT_SUB_NODE], 1);
+   memmove(&chunks[k], &chunks[k + 1],
+           (oChildren->numChunks - k - 1) * sizeof(struct chunk));
+   oChildren->numChunks--;
+
+   if(oChildren->numChunks == 1) {
+      oChildren->flat = chunks[0];
+      oChildren->flat.start = 0;
+      oChildren->chunks = &oChildren->flat;
+      oChildren->maxChunks = 0;
+      free(chunks);
+      STATS_ADD(frees[FT_SUB_NODE], 1);
+   }
+}
+
+/*
+   Merges chunk k of oChildren, which has just shrunk, with the
+   smaller of its neighbours if it is now empty, or if it is under
+   MERGE_BELOW children and the two fit in MERGED_MAX.
+*/
+static void Children_merge(Children_T oChildren, size_t k) {
+   struct chunk* chunks = oChildren->chunks;
+   size_t lower;
+
+   if(chunks[k].length == 0) {
+      Children_dropChunk(oChildren, k);
+      return;
+   }
+   if(chunks[k].length >= MERGE_BELOW)
+      return;
+
+   if(k == 0 || (k + 1 < oChildren->numChunks &&
+                 chunks[k + 1].length < chunks[k - 1].length))
+      lower = k;
+   else
+      lower = k - 1;
+   if(chunks[lower].length + chunks[lower + 1].length > MERGED_MAX)
+      return;
+
+   Children_moveSlots(&chunks[lower], chunks[lower].length,
+                      &chunks[lower + 1], 0, chunks[lower + 1].length);
+   chunks[lower].length += chunks[lower + 1].length;
+   Children_dropChunk(oChildren, lower + 1);
+}
+
+/* see children.h for specification */
+Node Children_removeAt(Children_T oChildren, size_t childID) {
+   struct chunk* chunk;
+   Node child;
+   size_t k;
+   size_t i;
+
+   assert(oChildren != NULL);
+   assert(childID < oChildren->length);
+
+   k = Children_findChunk(oChildren, childID);
+   chunk = &oChildren->chunks[k];
+   i = childID - chunk->start;
+   child = chunk->nodes[i];
+   chunk->length--;
+   Children_moveSlots(chunk, i, chunk, i + 1, chunk->length - i);
+   for(i = k + 1; i < oChildren->numChunks; i++)
+      oChildren->chunks[i].start--;
+   oChildren->length--;
+
+   /* the filter keeps the child's bits until it is next rebuilt */
+   if(oChildren->filter != NULL) {
+      oChildren->filterRemoved++;
+      if(oChildren->length < FILTER_MIN / 2)
+         Children_dropFilter(oChildren);
+   }
+
+   if(oChildren->numChunks > 1)
+      Children_merge(oChildren, k);
+   return child;
+}
+
+/* see children.h for specification */
+void Children_prefetch(Children_T oChildren) {
+   const struct chunk* flat;
+   size_t i;
+
+   assert(oChildren != NULL);
+
+   if(oChildren->numChunks > 1) {
+      __builtin_prefetch(&oChildren->chunks[oChildren->numChunks / 2]);
+      return;
+   }
+
+   /* every key and Node of a small array, or else the first probe
+      and the two that can follow it */
+   flat = &oChildren->flat;
+   if(flat->length <= PREFETCH_ALL) {
+      for(i = 0; i < flat->length; i += LINE_SLOTS) {
+         __builtin_prefetch(&flat->keys[i]);
+         __builtin_prefetch(&flat->nodes[i]);
+      }
+      return;
+   }
+   __builtin_prefetch(&flat->keys[flat->length / 2]);
+   __builtin_prefetch(&flat->keys[flat->length / 4]);
+   __builtin_prefetch(&flat->keys[flat->length / 4 * 3]);
+}
+
+/* see children.h for specification */
+void Children_addMemory(Children_T oChildren,
+                        struct FT_memory* pMemory) {
+   size_t k;
+
+   assert(oChildren != NULL);
+   assert(pMemory != NULL);
+
+   pMemory->childHeaderBytes += sizeof(struct children)
+      + oChildren->maxChunks * sizeof(struct chunk);
+   pMemory->childArrayBytes += oChildren->length * SLOT_SIZE;
+   pMemory->allocations += oChildren->maxChunks == 0 ? 1 : 2;
+   if(oChildren->filter != NULL) {
+      pMemory->filterBytes +=
+         oChildren->filterWords * sizeof(unsigned long);
+      pMemory->allocations++;
+   }
+   for(k = 0; k < oChildren->numChunks; k++) {
+      pMemory->childArraySlackBytes +=
+         (oChildren->chunks[k].capacity - oChildren->chunks[k].length)
+         * SLOT_SIZE;
+      if(oChildren->chunks[k].keys != NULL)
+         pMemory->allocations++;
+   }
+}
@@ -0,0 +1,128 @@
+/*--------------------------------------------------------------------*/
+/* children.h                                                         */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHILDREN_INCLUDED
+#define CHILDREN_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "ft.h"
+#include "node.h"
+
+/*
+   A Children_T holds the children of one type, files or directories,
+   of one directory, sorted by name, which is the order of
+   Node_compare for children of the same parent and type. A directory
+   keeps one Children_T of each type, so that a search for a child of
+   one type never compares names of the other.
+
+   A directory of up to CHILDREN_CHUNK children keeps them in one flat
+   array, as a DynArray would. Past that, the array splits into chunks
+   of at most CHILDREN_CHUNK children, reached through a directory of
+   chunks. An insertion or removal then moves the children of one
+   chunk and one entry per chunk, not every child after it, and a
+   search finds the chunk before it searches the children. A chunk
+   that shrinks to a quarter full merges with a neighbour if the two
+   fit in three quarters of a chunk, so that a run of insertions and
+   removals at one size does not split and merge over and over. A
+   directory that shrinks back to one chunk is flat again.
+
+   Beside each child, a chunk keeps a key that holds the first bytes
+   of its name, so that a search compares keys in one
+   contiguous array and reads a child's name only when the keys tie.
+
+   A Children_T created filtered also keeps, while it is large, a
+   Bloom filter of its children's names, which Children_mayContain
+   tests so that most searches for a name that is not there read one
+   word instead of a path of keys through the chunks.
+*/
+typedef struct children* Children_T;
+
+/* The most children in one chunk; a power of two. */
+enum { CHILDREN_CHUNK = 512 };
+
+/*
+  Returns a new, empty Children_T, or NULL if there is not enough
+  memory for it. If isFiltered is TRUE, it keeps a Bloom filter of its
+  children's names once it has enough of them for a search to cost
+  several cache misses. Filters are kept up to date by
+  Children_insertAt and Children_removeAt, and built and rebuilt only
+  by them.
+*/
+Children_T Children_new(boolean isFiltered);
+
+/*
+  Frees oChildren, but not the Nodes in it.
+*/
+void Children_free(Children_T oChildren);
+
+/*
+  Returns the number of children in oChildren.
+*/
+size_t Children_getLength(Children_T oChildren);
+
+/*
+  Returns the child of oChildren with identifier childID, its position
+  in the sorted order, which must be less than
+  Children_getLength(oChildren).
+*/
+Node Children_get(Children_T oChildren, size_t childID);
+
+/*
+  Searches oChildren for the child named by the length bytes at name
+  (which need not be '\0'-terminated). If there is one, stores its
+  identifier in *pChildID and returns TRUE; otherwise stores the
+  identifier that such a child would have in *pChildID and returns
+  FALSE.
+*/
+boolean Children_search(Children_T oChildren, const char* name,
+                        size_t length, size_t* pChildID);
+
+/*
+  Returns FALSE if oChildren certainly has no child named by the
+  length bytes at name (which need not be '\0'-terminated), and TRUE
+  if it may have one, which Children_search can tell. Always returns
+  TRUE while oChildren keeps no filter.
+*/
+boolean Children_mayContain(Children_T oChildren, const char* name,
+                            size_t length);
+
+/*
+  Inserts child into oChildren with identifier childID, which must be
+  the one that Children_search gives for it, shifting the identifiers
+  of the children after it up by one. Returns TRUE, or FALSE if there
+  is not enough memory, in which case oChildren is unchanged.
+*/
+boolean Children_insertAt(Children_T oChildren, size_t childID,
+                          Node child);
+
+/*
+  Removes and returns the child of oChildren with identifier childID,
+  which must be less than Children_getLength(oChildren), shifting the
+  identifiers of the children after it down by one. Never allocates
+  memory, so it cannot fail.
+*/
+Node Children_removeAt(Children_T oChildren, size_t childID);
+
+/*
+  Asks the processor to start loading the part of oChildren that
+  Children_search reads first, the keys in the middle of a flat array
+  or the middle of the directory of chunks, without waiting for it.
+  oChildren's header itself should be in the cache already, or this
+  waits for it.
+*/
+void Children_prefetch(Children_T oChildren);
+
+/*
+  Adds the heap memory that oChildren occupies to
+  pMemory->childHeaderBytes (its header and chunk directory),
+  pMemory->childArrayBytes and pMemory->childArraySlackBytes (the
+  child slots, key and Node, in use and spare), pMemory->filterBytes
+  (its filter), and its blocks to pMemory->allocations.
+*/
+void Children_addMemory(Children_T oChildren,
+                        struct FT_memory* pMemory);
+
+#endif
@@ -4,6 +4,7 @@
 /*--------------------------------------------------------------------*/
 
 #include "dynarray.h"
+#include "stats.h"
 #include <assert.h>
 #include <stdlib.h>
 
@@ -72,6 +73,7 @@ static int DynArray_grow(DynArray_T oDynArray)
 
    oDynArray->uPhysLength = uNewLength;
    oDynArray->ppvArray = ppvNewArray;
+   STATS_ADD(dynArrayGrows, 1);
    return 1;
 }
 
@@ -96,8 +98,11 @@ DynArray_T DynArray_new(size_t uLength)
    if (oDynArray->ppvArray == NULL)
    {
       free(oDynArray);
+      STATS_ADD(mallocs[FT_SUB_DYNARRAY], 1);
+      STATS_ADD(frees[FT_SUB_DYNARRAY], 1);
       return NULL;
    }
+   STATS_ADD(mallocs[FT_SUB_DYNARRAY], 2);
 
    return oDynArray;
 }
@@ -111,6 +116,7 @@ void DynArray_free(DynArray_T oDynArray)
 
    free(oDynArray->ppvArray);
    free(oDynArray);
+   STATS_ADD(frees[FT_SUB_DYNARRAY], 2);
 }
 
 /*--------------------------------------------------------------------*/
@@ -125,6 +131,23 @@ size_t DynArray_getLength(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
+size_t DynArray_getPhysLength(DynArray_T oDynArray)
+{
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   return oDynArray->uPhysLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DynArray_getHeaderSize(void)
+{
+   return sizeof(struct DynArray);
+}
+
+/*--------------------------------------------------------------------*/
+
 void *DynArray_get(DynArray_T oDynArray, size_t uIndex)
 {
    assert(oDynArray != NULL);
@@ -189,6 +212,8 @@ int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
 
    for (u = oDynArray->uLength; u > uIndex; u--)
       oDynArray->ppvArray[u] = oDynArray->ppvArray[u-1];
+   STATS_ADD(memmovedBytes,
+             (oDynArray->uLength - uIndex) * sizeof(void*));
 
    oDynArray->ppvArray[uIndex] = pvElement;
    oDynArray->uLength++;
@@ -215,6 +240,8 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 
    for (u = uIndex; u < oDynArray->uLength; u++)
       oDynArray->ppvArray[u] = oDynArray->ppvArray[u+1];
+   STATS_ADD(memmovedBytes,
+             (oDynArray->uLength - uIndex) * sizeof(void*));
 
    assert(DynArray_isValid(oDynArray));
 
@@ -384,6 +411,7 @@ static const void **DynArray_bsearchHelp(
    while (ppvLo <= ppvHi)
    {
       ppvMid = ppvLo + ((ppvHi - ppvLo) / 2);
+      STATS_ADD(bsearchProbes, 1);
       iCompare = (*pfCompare)(pvSoughtElement, *ppvMid);
       if (iCompare < 0)
          ppvHi = ppvMid - 1;
@@ -34,6 +34,20 @@ size_t DynArray_getLength(DynArray_T oDynArray);
 
 /*--------------------------------------------------------------------*/
 
+/* Return the physical length of oDynArray, that is, the number of
+   elements that its underlying array can hold before it must grow. */
+
+size_t DynArray_getPhysLength(DynArray_T oDynArray);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes that a DynArray_T object occupies apart
+   from its underlying array. */
+
+size_t DynArray_getHeaderSize(void);
+
+/*--------------------------------------------------------------------*/
+
 /* Return the uIndex'th element of oDynArray. */
 
 void *DynArray_get(DynArray_T oDynArray, size_t uIndex);
@@ -0,0 +1,465 @@
+/*--------------------------------------------------------------------*/
+/* dynarray_bench.c                                                   */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "a4def.h"
+#include "dynarray.h"
+#include "bench.h"
+
+/* Small sizes are measured on many arrays at once, so that each
+   timed batch covers at least this many elements. */
+enum { BATCH = 65536 };
+
+/* The most addAt or removeAt calls made on one array per timed batch;
+   at most 1/16 of the array, so that its length barely drifts. */
+enum { MAX_RUN = 64 };
+
+/* The number of random keys searched for per timed batch. */
+enum { PROBES = 1024 };
+
+/* The length of a key, "k" and ten digits, including its '\0'. */
+enum { KEY_LENGTH = 12 };
+
+/* Where addAt and removeAt operate: index 0, the middle element or
+   the last element (for addAt, just past it). */
+enum { AT_HEAD, AT_MID, AT_TAIL };
+
+/* The benchmark parameters, as given on the command line. */
+struct benchConfig {
+   /* the smallest number of elements measured */
+   size_t minSize;
+   /* the largest number of elements measured */
+   size_t maxSize;
+   /* the factor between consecutive sizes */
+   size_t growth;
+   /* the least time spent measuring each operation at each size */
+   size_t minNs;
+   /* the seed of the pseudo-random number generator */
+   unsigned long seed;
+};
+
+/* One measured operation: its name in the report, the function that
+   measures it at one size and where in the array it operates. The
+   function stores the number of operations it timed in *pOps and the
+   time they took in *pNs. */
+struct benchOp {
+   const char *name;
+   void (*pfMeasure)(size_t n, int where,
+                     const struct benchConfig *cfg,
+                     size_t *pOps, size_t *pNs);
+   int where;
+};
+
+/* The element stored by the operations that do not compare elements. */
+static char element[] = "e";
+
+/*--------------------------------------------------------------------*/
+
+/* Prints that the benchmark ran out of memory and exits. */
+static void Bench_outOfMemory(void) {
+   fprintf(stderr, "dynarray_bench: out of memory\n");
+   exit(EXIT_FAILURE);
+}
+
+/* Returns the number of arrays of n elements to measure at once. */
+static size_t Bench_numArrays(size_t n) {
+   if(n >= BATCH)
+      return 1;
+   return BATCH / n;
+}
+
+/* Returns a new block of n keys of KEY_LENGTH bytes each, which are
+   in ascending order and hold the even numbers from 0. */
+static char *Bench_newKeys(size_t n) {
+   char *keys = malloc(n * KEY_LENGTH);
+   size_t i;
+
+   if(keys == NULL)
+      Bench_outOfMemory();
+   for(i = 0; i < n; i++)
+      (void) sprintf(keys + i * KEY_LENGTH, "k%010lu",
+                     (unsigned long) (2 * i));
+   return keys;
+}
+
+/* Returns a new array of count DynArrays of n elements each: the n
+   keys of the block keys in order, or element if keys is NULL. */
+static DynArray_T *Bench_newArrays(size_t count, size_t n,
+                                   char *keys) {
+   DynArray_T *arrays = malloc(count * sizeof(DynArray_T));
+   size_t a;
+   size_t i;
+
+   if(arrays == NULL)
+      Bench_outOfMemory();
+   for(a = 0; a < count; a++) {
+      arrays[a] = DynArray_new(0);
+      if(arrays[a] == NULL)
+         Bench_outOfMemory();
+      for(i = 0; i < n; i++)
+         if(!DynArray_add(arrays[a], keys == NULL ? element :
+                          keys + i * KEY_LENGTH))
+            Bench_outOfMemory();
+   }
+   return arrays;
+}
+
+/* Frees the array of count DynArrays arrays. */
+static void Bench_freeArrays(DynArray_T *arrays, size_t count) {
+   size_t a;
+
+   for(a = 0; a < count; a++)
+      DynArray_free(arrays[a]);
+   free(arrays);
+}
+
+/* Returns the index at which to operate on an array whose last
+   usable index is last. */
+static size_t Bench_position(int where, size_t last) {
+   if(where == AT_HEAD)
+      return 0;
+   if(where == AT_MID)
+      return last / 2;
+   return last;
+}
+
+/* Compares the keys pvKey1 and pvKey2 with strcmp. */
+static int Bench_compareKeys(const void *pvKey1, const void *pvKey2) {
+   return strcmp((const char*) pvKey1, (const char*) pvKey2);
+}
+
+/* Counts the element pvElement in the size_t that pvCount points to. */
+static void Bench_countElement(void *pvElement, void *pvCount) {
+   (void) pvElement;
+   (*(size_t*) pvCount)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Times building arrays of n elements from empty with DynArray_add. */
+static void Bench_add(size_t n, int where,
+                      const struct benchConfig *cfg,
+                      size_t *pOps, size_t *pNs) {
+   size_t count = Bench_numArrays(n);
+   DynArray_T *arrays = malloc(count * sizeof(DynArray_T));
+   size_t start;
+   size_t a;
+   size_t i;
+
+   (void) where;
+
+   if(arrays == NULL)
+      Bench_outOfMemory();
+   *pOps = 0;
+   *pNs = 0;
+   do {
+      start = Bench_now();
+      for(a = 0; a < count; a++) {
+         arrays[a] = DynArray_new(0);
+         if(arrays[a] == NULL)
+            Bench_outOfMemory();
+         for(i = 0; i < n; i++)
+            if(!DynArray_add(arrays[a], element))
+               Bench_outOfMemory();
+      }
+      *pNs += Bench_now() - start;
+      *pOps += count * n;
+      for(a = 0; a < count; a++)
+         DynArray_free(arrays[a]);
+   } while(*pNs < cfg->minNs);
+   free(arrays);
+}
+
+/* Returns the number of addAt or removeAt calls to make on one array
+   of n elements per timed batch. */
+static size_t Bench_runLength(size_t n) {
+   if(n / 16 > MAX_RUN)
+      return MAX_RUN;
+   if(n / 16 == 0)
+      return 1;
+   return n / 16;
+}
+
+/* Times DynArray_addAt at where on arrays of about n elements,
+   removing the added elements again between timed batches. */
+static void Bench_addAt(size_t n, int where,
+                        const struct benchConfig *cfg,
+                        size_t *pOps, size_t *pNs) {
+   size_t count = Bench_numArrays(n);
+   size_t run = Bench_runLength(n);
+   DynArray_T *arrays = Bench_newArrays(count, n, NULL);
+   size_t start;
+   size_t a;
+   size_t r;
+
+   *pOps = 0;
+   *pNs = 0;
+   do {
+      start = Bench_now();
+      for(a = 0; a < count; a++)
+         for(r = 0; r < run; r++)
+            if(!DynArray_addAt(arrays[a], Bench_position(where,
+                                  DynArray_getLength(arrays[a])),
+                               element))
+               Bench_outOfMemory();
+      *pNs += Bench_now() - start;
+      *pOps += count * run;
+      for(a = 0; a < count; a++)
+         for(r = 0; r < run; r++)
+            (void) DynArray_removeAt(arrays[a],
+                                     DynArray_getLength(arrays[a]) - 1);
+   } while(*pNs < cfg->minNs);
+   Bench_freeArrays(arrays, count);
+}
+
+/* Times DynArray_removeAt at where on arrays of about n elements,
+   adding elements back between timed batches. */
+static void Bench_removeAt(size_t n, int where,
+                           const struct benchConfig *cfg,
+                           size_t *pOps, size_t *pNs) {
+   size_t count = Bench_numArrays(n);
+   size_t run = Bench_runLength(n);
+   DynArray_T *arrays = Bench_newArrays(count, n, NULL);
+   size_t start;
+   size_t a;
+   size_t r;
+
+   *pOps = 0;
+   *pNs = 0;
+   do {
+      for(a = 0; a < count; a++)
+         for(r = 0; r < run; r++)
+            if(!DynArray_add(arrays[a], element))
+               Bench_outOfMemory();
+      start = Bench_now();
+      for(a = 0; a < count; a++)
+         for(r = 0; r < run; r++)
+            (void) DynArray_removeAt(arrays[a], Bench_position(where,
+                                     DynArray_getLength(arrays[a]) - 1));
+      *pNs += Bench_now() - start;
+      *pOps += count * run;
+   } while(*pNs < cfg->minNs);
+   Bench_freeArrays(arrays, count);
+}
+
+/* Times DynArray_bsearch with a strcmp comparator for random keys in
+   a sorted array of n keys; about half of the keys are present. */
+static void Bench_bsearch(size_t n, int where,
+                          const struct benchConfig *cfg,
+                          size_t *pOps, size_t *pNs) {
+   char *keys = Bench_newKeys(n);
+   DynArray_T *arrays = Bench_newArrays(1, n, keys);
+   char *probes = malloc(PROBES * KEY_LENGTH);
+   size_t start;
+   size_t index;
+   size_t p;
+
+   (void) where;
+
+   if(probes == NULL)
+      Bench_outOfMemory();
+   *pOps = 0;
+   *pNs = 0;
+   do {
+      for(p = 0; p < PROBES; p++)
+         (void) sprintf(probes + p * KEY_LENGTH, "k%010lu",
+                        (unsigned long) (Bench_random() % (2 * n)));
+      start = Bench_now();
+      for(p = 0; p < PROBES; p++)
+         (void) DynArray_bsearch(arrays[0], probes + p * KEY_LENGTH,
+                                 &index, Bench_compareKeys);
+      *pNs += Bench_now() - start;
+      *pOps += PROBES;
+   } while(*pNs < cfg->minNs);
+   free(probes);
+   Bench_freeArrays(arrays, 1);
+   free(keys);
+}
+
+/* Times DynArray_sort with a strcmp comparator on arrays of n keys in
+   random order. Reports the time per element sorted. */
+static void Bench_sort(size_t n, int where,
+                       const struct benchConfig *cfg,
+                       size_t *pOps, size_t *pNs) {
+   size_t count = Bench_numArrays(n);
+   char *keys = Bench_newKeys(n);
+   DynArray_T *arrays = Bench_newArrays(count, n, keys);
+   size_t start;
+   size_t a;
+   size_t i;
+   size_t j;
+
+   (void) where;
+
+   *pOps = 0;
+   *pNs = 0;
+   do {
+      for(a = 0; a < count; a++)
+         for(i = n; i > 1; i--) {
+            j = Bench_random() % i;
+            DynArray_set(arrays[a], j,
+                  DynArray_set(arrays[a], i - 1,
+                               DynArray_get(arrays[a], j)));
+         }
+      start = Bench_now();
+      for(a = 0; a < count; a++)
+         DynArray_sort(arrays[a], Bench_compareKeys);
+      *pNs += Bench_now() - start;
+      *pOps += count * n;
+   } while(*pNs < cfg->minNs);
+   Bench_freeArrays(arrays, count);
+   free(keys);
+}
+
+/* Times DynArray_map with a counting function over arrays of n
+   elements. Reports the time per element visited. */
+static void Bench_map(size_t n, int where,
+                      const struct benchConfig *cfg,
+                      size_t *pOps, size_t *pNs) {
+   size_t count = Bench_numArrays(n);
+   DynArray_T *arrays = Bench_newArrays(count, n, NULL);
+   size_t visited = 0;
+   size_t start;
+   size_t a;
+
+   (void) where;
+
+   *pOps = 0;
+   *pNs = 0;
+   do {
+      start = Bench_now();
+      for(a = 0; a < count; a++)
+         DynArray_map(arrays[a], Bench_countElement, &visited);
+      *pNs += Bench_now() - start;
+      *pOps += count * n;
+   } while(*pNs < cfg->minNs);
+   assert(visited == *pOps);
+   Bench_freeArrays(arrays, count);
+}
+
+/* The operations measured, in the order they are reported. */
+static const struct benchOp benchOps[] = {
+   { "add", Bench_add, AT_TAIL },
+   { "addAt/head", Bench_addAt, AT_HEAD },
+   { "addAt/mid", Bench_addAt, AT_MID },
+   { "addAt/tail", Bench_addAt, AT_TAIL },
+   { "removeAt/head", Bench_removeAt, AT_HEAD },
+   { "removeAt/mid", Bench_removeAt, AT_MID },
+   { "removeAt/tail", Bench_removeAt, AT_TAIL },
+   { "bsearch", Bench_bsearch, AT_HEAD },
+   { "sort", Bench_sort, AT_HEAD },
+   { "map", Bench_map, AT_HEAD }
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Measures op at every size from cfg->minSize to cfg->maxSize and
+   prints one line per size: the time per operation and its ratio to
+   the time at the previous size. */
+static void Bench_run(const struct benchOp *op,
+                      const struct benchConfig *cfg) {
+   double previous = 0;
+   double nsPerOp;
+   size_t n;
+   size_t ops;
+   size_t ns;
+
+   Bench_seed(cfg->seed);
+   for(n = cfg->minSize; n <= cfg->maxSize; n *= cfg->growth) {
+      op->pfMeasure(n, op->where, cfg, &ops, &ns);
+      nsPerOp = (double) ns / (double) ops;
+      printf("%-14s %10lu %12lu %10.2f", op->name, (unsigned long) n,
+             (unsigned long) ops, nsPerOp);
+      if(previous > 0)
+         printf(" %8.2f\n", nsPerOp / previous);
+      else
+         printf(" %8s\n", "-");
+      previous = nsPerOp;
+      (void) fflush(stdout);
+      if(n > cfg->maxSize / cfg->growth)
+         break;
+   }
+}
+
+/* Returns TRUE if the operation named name is selected by workload:
+   "all", its whole name, or the part of its name before the '/'. */
+static boolean Bench_isSelected(const char *name, const char *workload) {
+   size_t length = strlen(workload);
+
+   if(!strcmp(workload, "all"))
+      return TRUE;
+   return !strncmp(name, workload, length) &&
+          (name[length] == '\0' || name[length] == '/');
+}
+
+/* Prints how to invoke the program to stderr. */
+static void Bench_usage(const char *program) {
+   fprintf(stderr,
+      "usage: %s [-w operation] [-a min] [-n max] [-g growth]\n"
+      "          [-t ms] [-s seed]\n"
+      "operations: add, addAt[/head|/mid|/tail],\n"
+      "            removeAt[/head|/mid|/tail], bsearch, sort, map,\n"
+      "            all (default)\n", program);
+}
+
+/* Measures the DynArray operations selected on the command line (see
+   Bench_usage) at every size from min to max elements, multiplying
+   the size by growth each step, and prints the time per operation at
+   each size. The last column is the ratio to the previous size, so
+   that it stays near 1 for constant-time operations and near growth
+   for linear ones. Returns 0, or 1 if the command line is invalid. */
+int main(int argc, char *argv[]) {
+   struct benchConfig cfg;
+   const char *workload = "all";
+   boolean isKnown = FALSE;
+   size_t o;
+   int option;
+
+   cfg.minSize = 2;
+   cfg.maxSize = 1000000;
+   cfg.growth = 4;
+   cfg.minNs = 10000000;
+   cfg.seed = 217;
+
+   while((option = getopt(argc, argv, "w:a:n:g:t:s:")) != -1) {
+      switch(option) {
+         case 'w': workload = optarg; break;
+         case 'a': cfg.minSize = strtoul(optarg, NULL, 10); break;
+         case 'n': cfg.maxSize = strtoul(optarg, NULL, 10); break;
+         case 'g': cfg.growth = strtoul(optarg, NULL, 10); break;
+         case 't':
+            cfg.minNs = strtoul(optarg, NULL, 10) * 1000000;
+            break;
+         case 's': cfg.seed = strtoul(optarg, NULL, 10); break;
+         default:
+            Bench_usage(argv[0]);
+            return 1;
+      }
+   }
+   for(o = 0; o < sizeof(benchOps) / sizeof(benchOps[0]); o++)
+      if(Bench_isSelected(benchOps[o].name, workload))
+         isKnown = TRUE;
+   if(optind != argc || !isKnown || cfg.minSize == 0 ||
+      cfg.minSize > cfg.maxSize || cfg.maxSize > 100000000 ||
+      cfg.growth < 2) {
+      Bench_usage(argv[0]);
+      return 1;
+   }
+
+   printf("%-14s %10s %12s %10s %8s\n", "operation", "n", "ops",
+          "ns/op", "vs prev");
+   for(o = 0; o < sizeof(benchOps) / sizeof(benchOps[0]); o++)
+      if(Bench_isSelected(benchOps[o].name, workload))
+         Bench_run(&benchOps[o], &cfg);
+
+   return 0;
+}
@@ -0,0 +1,523 @@
+/*--------------------------------------------------------------------*/
+/* engine.c                                                           */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+#include "path.h"
+#include "stats.h"
+
+/* The number of slots a hash index starts with once it is first
+   used; always a power of two. */
+enum { HASH_MIN_CAPACITY = 8 };
+
+/*
+   Compares the name of Node child with the length bytes at name, in
+   the order of strcmp. Children of the same parent share their path
+   up to their names, so this orders them as Node_compare does within
+   each type.
+*/
+static int Engine_compareName(Node child, const char* name,
+                              size_t length) {
+   STATS_ADD(nodeCompares, 1);
+
+   return Path_compare(Node_getName(child), Node_getNameLength(child),
+                       name, length);
+}
+
+/*--------------------------------------------------------------------*/
+/* The "sorted" engine                                                */
+/*--------------------------------------------------------------------*/
+
+/* see engine.h for specification */
+static Node Engine_sortedFind(Node parent, boolean isFile,
+                              const char* name, size_t length) {
+   Node child;
+
+   assert(parent != NULL);
+   assert(name != NULL);
+
+   child = Node_searchChild(parent, isFile, name, length);
+   if(child == NULL)
+      child = Node_searchChild(parent, !isFile, name, length);
+   return child;
+}
+
+/*--------------------------------------------------------------------*/
+/* The "hash" engine                                                  */
+/*--------------------------------------------------------------------*/
+
+/* One slot of a hash index. */
+struct hashEntry {
+   /* the hash of node's name */
+   size_t hash;
+   /* the child stored in this slot, or NULL if the slot is empty */
+   Node node;
+};
+
+/*
+   A hash index is an open-addressing table with linear probing. It
+   is kept at most half full, and removals shift later entries back
+   rather than leaving tombstones.
+*/
+struct hashIndex {
+   /* the number of slots, 0 or a power of two */
+   size_t capacity;
+   /* the number of children stored */
+   size_t used;
+   /* the slots, or NULL while capacity is 0 */
+   struct hashEntry* entries;
+};
+
+/* Returns the FNV-1a hash of the length bytes at name. */
+static size_t Engine_hashName(const char* name, size_t length) {
+   size_t hash = 2166136261UL;
+   size_t i;
+
+   for(i = 0; i < length; i++) {
+      hash ^= (unsigned char) name[i];
+      hash *= 16777619UL;
+   }
+   return hash;
+}
+
+/* see engine.h for specification */
+static void* Engine_hashNew(void) {
+   struct hashIndex* index = malloc(sizeof(struct hashIndex));
+
+   if(index == NULL)
+      return NULL;
+   STATS_ADD(mallocs[FT_SUB_ENGINE], 1);
+
+   index->capacity = 0;
+   index->used = 0;
+   index->entries = NULL;
+   return index;
+}
+
+/* see engine.h for specification */
+static void Engine_hashFree(void* pvIndex) {
+   struct hashIndex* index = pvIndex;
+
+   assert(index != NULL);
+
+   if(index->entries != NULL) {
+      free(index->entries);
+      STATS_ADD(frees[FT_SUB_ENGINE], 1);
+   }
+   free(index);
+   STATS_ADD(frees[FT_SUB_ENGINE], 1);
+}
+
+/*
+   Stores node, whose name hashes to hash, in the first empty slot of
+   its probe sequence in the capacity slots entries.
+*/
+static void Engine_hashPlace(struct hashEntry* entries, size_t capacity,
+                             size_t hash, Node node) {
+   size_t slot = hash & (capacity - 1);
+
+   while(entries[slot].node != NULL)
+      slot = (slot + 1) & (capacity - 1);
+   entries[slot].hash = hash;
+   entries[slot].node = node;
+}
+
+/*
+   Doubles the capacity of index (or gives it its first slots),
+   rehashing its entries. Returns TRUE, or FALSE if there is no memory
+   to do so, in which case index is unchanged.
+*/
+static boolean Engine_hashGrow(struct hashIndex* index) {
+   size_t capacity;
+   struct hashEntry* entries;
+   size_t slot;
+
+   if(index->capacity == 0)
+      capacity = HASH_MIN_CAPACITY;
+   else
+      capacity = index->capacity * 2;
+
+   entries = calloc(capacity, sizeof(struct hashEntry));
+   if(entries == NULL)
+      return FALSE;
+   STATS_ADD(mallocs[FT_SUB_ENGINE], 1);
+
+   for(slot = 0; slot < index->capacity; slot++)
+      if(index->entries[slot].node != NULL)
+         Engine_hashPlace(entries, capacity, index->entries[slot].hash,
+                          index->entries[slot].node);
+
+   if(index->entries != NULL) {
+      free(index->entries);
+      STATS_ADD(frees[FT_SUB_ENGINE], 1);
+   }
+   index->entries = entries;
+   index->capacity = capacity;
+   return TRUE;
+}
+
+/* see engine.h for specification */
+static boolean Engine_hashInsert(void* pvIndex, Node child) {
+   struct hashIndex* index = pvIndex;
+
+   assert(index != NULL);
+   assert(child != NULL);
+
+   if((index->used + 1) * 2 > index->capacity)
+      if(!Engine_hashGrow(index))
+         return FALSE;
+
+   Engine_hashPlace(index->entries, index->capacity,
+                    Engine_hashName(Node_getName(child),
+                                    Node_getNameLength(child)), child);
+   index->used++;
+   return TRUE;
+}
+
+/* see engine.h for specification */
+static void Engine_hashRemove(void* pvIndex, Node child) {
+   struct hashIndex* index = pvIndex;
+   size_t mask;
+   size_t slot;
+   size_t next;
+   size_t home;
+
+   assert(index != NULL);
+   assert(child != NULL);
+   assert(index->capacity != 0);
+
+   mask = index->capacity - 1;
+   slot = Engine_hashName(Node_getName(child),
+                          Node_getNameLength(child)) & mask;
+   while(index->entries[slot].node != child) {
+      assert(index->entries[slot].node != NULL);
+      slot = (slot + 1) & mask;
+   }
+
+   /* Shift back every later entry of the same run whose probe
+      sequence passes through the emptied slot. */
+   next = slot;
+   for(;;) {
+      next = (next + 1) & mask;
+      if(index->entries[next].node == NULL)
+         break;
+      home = index->entries[next].hash & mask;
+      if(((next - home) & mask) >= ((next - slot) & mask)) {
+         index->entries[slot] = index->entries[next];
+         slot = next;
+      }
+   }
+   index->entries[slot].node = NULL;
+   index->used--;
+}
+
+/* see engine.h for specification */
+static Node Engine_hashFind(Node parent, boolean isFile,
+                            const char* name, size_t length) {
+   struct hashIndex* index;
+   size_t hash;
+   size_t mask;
+   size_t slot;
+
+   assert(parent != NULL);
+   assert(name != NULL);
+
+   /* one index holds children of both types, which never share a
+      name, so the type expected makes no difference */
+   (void) isFile;
+
+   index = Node_getIndex(parent);
+   if(index->used == 0)
+      return NULL;
+
+   hash = Engine_hashName(name, length);
+   mask = index->capacity - 1;
+   for(slot = hash & mask; index->entries[slot].node != NULL;
+       slot = (slot + 1) & mask)
+      if(index->entries[slot].hash == hash &&
+         Engine_compareName(index->entries[slot].node, name,
+                            length) == 0)
+         return index->entries[slot].node;
+   return NULL;
+}
+
+/* see engine.h for specification */
+static void Engine_hashAddMemory(void* pvIndex,
+                                 struct FT_memory* pMemory) {
+   struct hashIndex* index = pvIndex;
+
+   assert(index != NULL);
+   assert(pMemory != NULL);
+
+   pMemory->indexBytes += sizeof(struct hashIndex)
+      + index->capacity * sizeof(struct hashEntry);
+   pMemory->allocations += index->entries == NULL ? 1 : 2;
+}
+
+/*--------------------------------------------------------------------*/
+/* The "trie" engine                                                  */
+/*--------------------------------------------------------------------*/
+
+/*
+   A node of a ternary search trie. Each name is spelled out along eq
+   links, one character per trieNode, and ends at a trieNode for its
+   '\0' that holds the child; lo and hi lead to trieNodes for other
+   characters in the same position.
+*/
+struct trieNode {
+   /* the character this trieNode stands for */
+   char split;
+   /* the trieNode for the next character of names with this one */
+   struct trieNode* eq;
+   /* the trieNodes for smaller and larger characters here */
+   struct trieNode* lo;
+   struct trieNode* hi;
+   /* for a '\0' trieNode, the child whose name ends here */
+   Node child;
+};
+
+/* A trie index: a ternary search trie of the children's names. */
+struct trieIndex {
+   /* the top trieNode, or NULL if the trie is empty */
+   struct trieNode* top;
+   /* the number of trieNodes in the trie */
+   size_t trieNodes;
+};
+
+/* see engine.h for specification */
+static void* Engine_trieNew(void) {
+   struct trieIndex* index = malloc(sizeof(struct trieIndex));
+
+   if(index == NULL)
+      return NULL;
+   STATS_ADD(mallocs[FT_SUB_ENGINE], 1);
+
+   index->top = NULL;
+   index->trieNodes = 0;
+   return index;
+}
+
+/* Frees the trie rooted at t. Rather than recursing, moves each eq
+   subtree into the empty lo link and rotates lo subtrees up until the
+   top trieNode has only a hi link left, so the trie may be of any
+   depth. */
+static void Engine_trieFreeFrom(struct trieNode* t) {
+   struct trieNode* lo;
+   struct trieNode* hi;
+
+   while(t != NULL) {
+      if(t->lo == NULL && t->eq != NULL) {
+         t->lo = t->eq;
+         t->eq = NULL;
+      }
+      if(t->lo != NULL) {
+         lo = t->lo;
+         t->lo = lo->hi;
+         lo->hi = t;
+         t = lo;
+      }
+      else {
+         hi = t->hi;
+         free(t);
+         STATS_ADD(frees[FT_SUB_ENGINE], 1);
+         t = hi;
+      }
+   }
+}
+
+/* see engine.h for specification */
+static void Engine_trieFree(void* pvIndex) {
+   struct trieIndex* index = pvIndex;
+
+   assert(index != NULL);
+
+   Engine_trieFreeFrom(index->top);
+   free(index);
+   STATS_ADD(frees[FT_SUB_ENGINE], 1);
+}
+
+/* see engine.h for specification */
+static boolean Engine_trieInsert(void* pvIndex, Node child) {
+   struct trieIndex* index = pvIndex;
+   struct trieNode** pLink;
+   struct trieNode* t;
+   const char* name;
+
+   assert(index != NULL);
+   assert(child != NULL);
+
+   name = Node_getName(child);
+   pLink = &index->top;
+   for(;;) {
+      t = *pLink;
+      if(t == NULL) {
+         /* Any trieNodes added before running out of memory are left
+            in place; they hold no child, so lookups pass over them. */
+         t = malloc(sizeof(struct trieNode));
+         if(t == NULL)
+            return FALSE;
+         STATS_ADD(mallocs[FT_SUB_ENGINE], 1);
+         t->split = *name;
+         t->eq = t->lo = t->hi = NULL;
+         t->child = NULL;
+         *pLink = t;
+         index->trieNodes++;
+      }
+
+      if(*name < t->split)
+         pLink = &t->lo;
+      else if(*name > t->split)
+         pLink = &t->hi;
+      else if(*name == '\0') {
+         assert(t->child == NULL);
+         t->child = child;
+         return TRUE;
+      }
+      else {
+         pLink = &t->eq;
+         name++;
+      }
+   }
+}
+
+/* see engine.h for specification */
+static void Engine_trieRemove(void* pvIndex, Node child) {
+   struct trieIndex* index = pvIndex;
+   struct trieNode** pLink = &index->top;
+   struct trieNode** pNext;
+   /* the link to the first of the trieNodes at the end of the search
+      path that lead only to child, or NULL if there are none yet */
+   struct trieNode** pCut = NULL;
+   struct trieNode* t;
+   struct trieNode* next;
+   const char* name;
+
+   assert(index != NULL);
+   assert(child != NULL);
+
+   /* The trieNodes that removing child leaves with no child and no
+      links are the ones past the last trieNode on the path that holds
+      another child or has a link off the path; find them on the way
+      down. */
+   name = Node_getName(child);
+   for(;;) {
+      t = *pLink;
+      assert(t != NULL);
+
+      if(*name < t->split)
+         pNext = &t->lo;
+      else if(*name > t->split)
+         pNext = &t->hi;
+      else if(*name == '\0')
+         pNext = NULL;
+      else {
+         pNext = &t->eq;
+         name++;
+      }
+
+      if((t->child != NULL && pNext != NULL) ||
+         (t->lo != NULL && pNext != &t->lo) ||
+         (t->hi != NULL && pNext != &t->hi) ||
+         (t->eq != NULL && pNext != &t->eq))
+         pCut = NULL;
+      else if(pCut == NULL)
+         pCut = pLink;
+
+      if(pNext == NULL)
+         break;
+      pLink = pNext;
+   }
+   t->child = NULL;
+
+   if(pCut != NULL) {
+      t = *pCut;
+      *pCut = NULL;
+      while(t != NULL) {
+         next = t->lo != NULL ? t->lo : t->hi != NULL ? t->hi : t->eq;
+         free(t);
+         STATS_ADD(frees[FT_SUB_ENGINE], 1);
+         index->trieNodes--;
+         t = next;
+      }
+   }
+}
+
+/* see engine.h for specification */
+static Node Engine_trieFind(Node parent, boolean isFile,
+                            const char* name, size_t length) {
+   struct trieIndex* index;
+   struct trieNode* t;
+   size_t i = 0;
+   char c;
+
+   assert(parent != NULL);
+   assert(name != NULL);
+
+   (void) isFile;
+
+   index = Node_getIndex(parent);
+   t = index->top;
+   while(t != NULL) {
+      STATS_ADD(nodeCompares, 1);
+      c = i < length ? name[i] : '\0';
+      if(c < t->split)
+         t = t->lo;
+      else if(c > t->split)
+         t = t->hi;
+      else if(c == '\0')
+         /* An embedded '\0' in name ends it early: no match. */
+         return i == length ? t->child : NULL;
+      else {
+         t = t->eq;
+         i++;
+      }
+   }
+   return NULL;
+}
+
+/* see engine.h for specification */
+static void Engine_trieAddMemory(void* pvIndex,
+                                 struct FT_memory* pMemory) {
+   struct trieIndex* index = pvIndex;
+
+   assert(index != NULL);
+   assert(pMemory != NULL);
+
+   pMemory->indexBytes += sizeof(struct trieIndex)
+      + index->trieNodes * sizeof(struct trieNode);
+   pMemory->allocations += 1 + index->trieNodes;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Every engine, the default first. */
+static const struct Engine engines[] = {
+   { "sorted", NULL, NULL, NULL, NULL, Engine_sortedFind, NULL },
+   { "hash", Engine_hashNew, Engine_hashFree, Engine_hashInsert,
+     Engine_hashRemove, Engine_hashFind, Engine_hashAddMemory },
+   { "trie", Engine_trieNew, Engine_trieFree, Engine_trieInsert,
+     Engine_trieRemove, Engine_trieFind, Engine_trieAddMemory }
+};
+
+/* see engine.h for specification */
+const struct Engine* Engine_lookup(const char* name) {
+   size_t e;
+
+   assert(name != NULL);
+
+   for(e = 0; e < sizeof(engines) / sizeof(engines[0]); e++)
+      if(!strcmp(name, engines[e].name))
+         return &engines[e];
+   return NULL;
+}
+
+/* see engine.h for specification */
+const struct Engine* Engine_get(size_t engineID) {
+   if(engineID >= sizeof(engines) / sizeof(engines[0]))
+      return NULL;
+   return &engines[engineID];
+}
@@ -0,0 +1,71 @@
+/*--------------------------------------------------------------------*/
+/* engine.h                                                           */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef ENGINE_INCLUDED
+#define ENGINE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "node.h"
+
+/*
+   An Engine finds the child of a directory Node by name. Every
+   directory keeps its files and its subdirectories apart, each sorted
+   by name (see children.h), and Node_getChild numbers them in the
+   order of Node_compare, which traversals and toString rely on; an
+   Engine may keep an index of those children beside them to find
+   them faster, or search them itself. One Engine serves every Node in
+   the tree, and it is chosen before the tree is built.
+
+   The engines are:
+   "sorted" - binary search of the sorted children of the type
+              expected, then of the other type (no index)
+   "hash"   - an open-addressing hash table of the children's names
+   "trie"   - a ternary search trie of the children's names
+*/
+struct Engine {
+   /* the name that FT_setEngine selects this engine by */
+   const char* name;
+
+   /* Returns a new, empty index, or NULL if there is no memory for
+      it. This and every other member that takes an index are NULL for
+      an engine that keeps no index. */
+   void* (*newIndex)(void);
+
+   /* Frees index, but not the Nodes that it indexes. */
+   void (*freeIndex)(void* index);
+
+   /* Adds child to index, under its name. Returns TRUE, or FALSE if
+      there is no memory to do so, in which case index is unchanged. */
+   boolean (*insert)(void* index, Node child);
+
+   /* Removes child, which must be in index, from index. */
+   void (*remove)(void* index, Node child);
+
+   /* Returns the child of directory parent, of either type, named by
+      the length bytes at name (which need not be '\0'-terminated), or
+      NULL if parent has no such child. isFile is the type that the
+      caller expects the child to have, which an engine may look for
+      first. */
+   Node (*find)(Node parent, boolean isFile, const char* name,
+                size_t length);
+
+   /* Adds the heap memory that index occupies to
+      pMemory->indexBytes and its blocks to pMemory->allocations. */
+   void (*addMemory)(void* index, struct FT_memory* pMemory);
+};
+
+/*
+  Returns the engine named name, or NULL if there is no such engine.
+*/
+const struct Engine* Engine_lookup(const char* name);
+
+/*
+  Returns the engine with identifier engineID (from 0), or NULL if
+  there are not that many engines. Engine 0 is the default.
+*/
+const struct Engine* Engine_get(size_t engineID);
+
+#endif
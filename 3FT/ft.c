@@ -14,6 +14,11 @@
 #include "node.h"
 #include "checker.h"
 #include "handler.h"
+#include "handle.h"
+#include "path.h"
+#include "engine.h"
+#include "stats.h"
+#include "trace.h"
 
 /*--------------------------------------------------------------------*/
 
@@ -22,142 +27,213 @@
 static boolean isInitialized;
 /* a pointer to the root Node in the hierarchy */
 static Node root;
-/* a counter of the number of Nodes in the hierarchy */
+/* a counter of the number of Nodes in the hierarchy, which calls
+   working in different subtrees may update concurrently */
 static size_t count;
 
+/* The number of removals from the tree, each of which may free Nodes
+   that a finger holds. It is shared by every subtree, so it is only
+   read and changed atomically: a removal adds to it with release
+   ordering, and a lookup reads it with acquire ordering. */
+static size_t epoch;
+
+/* The Node at which the calling thread's last path lookup ended, for
+   the next one to start from. */
+struct finger {
+   /* the Node, or NULL if there is none */
+   Node n;
+   /* the child of the root that n is or is below */
+   Node top;
+   /* the value of epoch when n was found */
+   size_t epoch;
+};
+static __thread struct finger finger;
+
+/* The number of paths that FT_statBatch hands to the handler at a
+   time, from arrays on its stack. */
+enum { STAT_BLOCK = 256 };
+
+
+/* Returns the deepest of curr and its ancestors whose path is a
+   prefix of path, the pathLength bytes at path, that ends at a
+   component of it, or NULL if there is none. */
+static Node FT_climbToPrefix(Node curr, const char *path,
+                             size_t pathLength) {
+   const char *currPath;
+   size_t shared = 0;
+   size_t currLength;
 
-/* Inserts a new path into the tree rooted at parent, with leaf being
-   a node with path path, contents contents, length length, and type
-   as its value for isFile.
-   If the root of the data structure is NULL, then inserts this path's
-   first node as the root.
-   If the parent is NULL but there exists a root in the tree, return
-   CONFLICTING_PATH.
-   If the given path exists, return ALREADY_IN_TREE.
-   If parent is a file, return NOT_A_DIRECTORY.
+   if(curr == NULL)
+      return NULL;
+
+   /* the path of every ancestor of curr is a prefix of curr's, so one
+      pass over curr's path finds how much of it each one shares */
+   currPath = Node_getPath(curr);
+   currLength = Node_getPathLength(curr);
+   while(shared < currLength && shared < pathLength &&
+         currPath[shared] == path[shared])
+      shared++;
+
+   while(curr != NULL &&
+         ((currLength = Node_getPathLength(curr)) > shared ||
+          (currLength != pathLength && path[currLength] != '/')))
+      curr = Node_getParent(curr);
+   return curr;
+}
+
+/* Returns the child of the root that n, which must be below the root,
+   is or is below. */
+static Node FT_topOf(Node n) {
+   Node parent;
+
+   assert(n != NULL);
+
+   while(Node_getParent(parent = Node_getParent(n)) != NULL)
+      n = parent;
+   return n;
+}
+
+/* Returns the farthest Node (directory or file) reachable from the root
+   following path, the pathLength bytes at path, or NULL if there is no
+   Node in the tree which matches a prefix of path. isFile is the type
+   that the caller expects the Node of the whole path to have, which
+   the search for its name tries first.
+   When no Node has been removed since the calling thread's finger was
+   set, and path is below the same child of the root, the search climbs
+   from the finger to the deepest Node that path shares with it and
+   descends only from there, so that paths in the same or neighbouring
+   directories skip the levels they have in common. The child of the
+   root is checked first because only it is kept from being removed by
+   calls of other threads, and the finger itself is read only once
+   path is known to be in its subtree. */
+static Node FT_traversePath(const char* path, size_t pathLength,
+                            boolean isFile) {
+   Node curr = NULL;
+   Node top = NULL;
+   size_t topLength;
+   size_t now;
+
+   assert(path != NULL);
+
+   STATS_ADD(lookups, 1);
+
+   now = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+   if(finger.n != NULL && finger.epoch == now) {
+      topLength = Node_getPathLength(finger.top);
+      if(topLength <= pathLength &&
+         (topLength == pathLength || path[topLength] == '/') &&
+         Path_compare(path, topLength, Node_getPath(finger.top),
+                      topLength) == 0) {
+         top = finger.top;
+         curr = FT_climbToPrefix(finger.n, path, pathLength);
+      }
+   }
+
+   if(curr != NULL) {
+      STATS_ADD(fingerHits, 1);
+      curr = HANDLER_descendFrom(path, pathLength, curr, isFile);
+   }
+   else
+      curr = HANDLER_traversePathFrom(path, pathLength, root, isFile);
+
+   if(curr == NULL || Node_getParent(curr) == NULL)
+      finger.n = NULL;
+   else {
+      finger.n = curr;
+      finger.top = top != NULL ? top : FT_topOf(curr);
+      finger.epoch = now;
+   }
+   return curr;
+}
+
+/* Returns TRUE if curr, which FT_traversePath returned for a path of
+   pathLength bytes, is the Node of that whole path. The path of the
+   Node that FT_traversePath returns is a prefix of the path it
+   followed, so comparing lengths suffices. */
+static boolean FT_isWholePath(Node curr, size_t pathLength) {
+   return curr != NULL && Node_getPathLength(curr) == pathLength;
+}
+
+/* Inserts the components of the path from restPath to end into the
+   tree below parent, with the last one being a node with contents
+   contents, length length, and type as its value for isFile, and every
+   one before it a directory. If parent is NULL, the first component
+   becomes the root of the data structure.
+   If no component is left once trailing slashes are dropped, return
+   ALREADY_IN_TREE, for the path names parent.
    If there's an allocation error in creating any of the new nodes or
    their fields, return MEMORY_ERROR.
    If there is an error linking any of the new nodes, return
    PARENT_CHILD_ERROR.
-   Else, return SUCCESS. */
-static int FT_insertRestOfPath(char* path, Node parent, boolean type,
-                               void *contents, size_t length) {
+   Else, return SUCCESS.
+   The new nodes are named straight from the path, which is split into
+   components PATH_PARTS at a time without being copied; empty
+   components, from doubled or trailing slashes, are skipped. */
+static int FT_insertBelow(Node parent, const char* restPath,
+                          const char* end, boolean type,
+                          void *contents, size_t length) {
    /* The node of which the added Node(s) will be a child. */
    Node curr = parent;
    /* The child to be added to curr, and the Node a the path's head. */
    Node firstNew = NULL;
    Node new;
-   char* copyPath;
-   char* restPath = path;
-   char* dirToken;
-   char* dirNextToken;
+   struct Path_component parts[PATH_PARTS];
+   size_t numParts;
+   size_t k;
+   boolean isLeaf;
    int result;
    size_t newCount = 0;
 
-   assert(path != NULL);
-
-   if(curr == NULL){
-      if(root != NULL) {
-      /* If there is a root, but the parent is NULL,
-         then it is a conflicting path error.
-         NOTE: ft.h stipulates we should return NO_SUCH_PATH
-         instead if this happens for a file, but the checker
-         suggests the more generally valid approach we use here. */
-      return CONFLICTING_PATH;
-      }
-   }
-   else if(!strcmp(path, Node_getPath(curr)))
-      return ALREADY_IN_TREE;
-   else if (Node_isFile(curr))
-      return NOT_A_DIRECTORY;
-   else {
-      /* If there are no path issues, restPath denotes the portion of
-         the path which remains to be added to the data structure. */
-      restPath += (strlen(Node_getPath(curr)) + 1);
-   }
-
-   /* Copy restPath into copyPath, which is then tokenized in order to
-      determine the names of the nodes to be inserted. */
-   copyPath = malloc(strlen(restPath)+1);
-   if(copyPath == NULL)
-      return MEMORY_ERROR;
-   strcpy(copyPath, restPath);
-   /* Stores the local path name of the next node to be added. */
-   dirToken = strtok(copyPath, "/");
-   /* Stores the local path name of the node after the node to add. */
-   dirNextToken = strtok(NULL, "/");
-
-   /* While the node to add has a "child," meaning it's not a leaf,
-      iteratively add it to the tree. */
-   while(dirNextToken != NULL) {
-      /* If it's not a leaf, it cannot be a file so make new dir. */
-      new = Node_createDir(dirToken, curr);
-      newCount++;
-
-      if(firstNew == NULL)
-         firstNew = new;
-      else {
-         /* For nodes other than the first, attempt to link them in
-            the order dictated by the path. */
-         result = HANDLER_linkParentToChild(curr, new);
-         if(result != SUCCESS) {
-            (void) Node_destroy(new);
-            (void) Node_destroy(firstNew);
-            free(copyPath);
-            return result;
+   assert(restPath != NULL);
+   assert(end != NULL);
+
+   /* Trailing slashes name no node, so the last component left is the
+      leaf. */
+   while(end != restPath && end[-1] == '/')
+      end--;
+   for(;;) {
+      numParts = Path_split(restPath, (size_t) (end - restPath), parts,
+                            PATH_PARTS);
+      for(k = 0; k < numParts; k++) {
+         if(parts[k].length == 0)
+            continue;
+
+         /* Every node but the leaf is a directory. */
+         isLeaf = parts[k].name + parts[k].length == end;
+         new = Node_create(parts[k].name, parts[k].length, curr,
+                           isLeaf && type);
+         if(new == NULL) {
+            if(firstNew != NULL)
+               (void) Node_destroy(firstNew);
+            return MEMORY_ERROR;
          }
-      }
-
-      /* If there is no non-null node added, there was a MEMORY_ERROR */
-      if(new == NULL) {
-         (void) Node_destroy(firstNew);
-         free(copyPath);
-         return MEMORY_ERROR;
-      }
-
-      /* Parent becomes the node just added, and the two tokens
-         iterate one step down the path to determine which nodes will
-         be added next. */
-      curr = new;
-      dirToken = dirNextToken;
-      dirNextToken = strtok(NULL, "/");
-   }
-
-   /* If the child is NULL but there is another node to add, we enter
-      this block and append the leaf to the data structure. Internally,
-      it's analogous to the previous for loop.*/
-   if(dirToken != NULL) {
-      if(type) {
-         new = Node_createFile(dirToken, curr);
-         Node_setContents(new, contents, length);
-      }
-      else
-         new = Node_createDir(dirToken, curr);
-
-      newCount++;
-
-      if(firstNew == NULL)
-         firstNew = new;
-      else {
-         result = HANDLER_linkParentToChild(curr, new);
-         if(result != SUCCESS) {
-            (void) Node_destroy(new);
-            (void) Node_destroy(firstNew);
-            free(copyPath);
-            return result;
+         newCount++;
+         if(isLeaf && type)
+            (void) Node_setContents(new, contents, length);
+
+         if(firstNew == NULL)
+            firstNew = new;
+         else {
+            /* For nodes other than the first, attempt to link them in
+               the order dictated by the path. On failure the handler
+               destroys new itself. */
+            result = HANDLER_linkParentToChild(curr, new);
+            if(result != SUCCESS) {
+               (void) Node_destroy(firstNew);
+               return result;
+            }
          }
-      }
 
-      if(new == NULL) {
-         (void) Node_destroy(firstNew);
-         free(copyPath);
-         return MEMORY_ERROR;
+         curr = new;
       }
+      restPath = parts[numParts - 1].name + parts[numParts - 1].length;
+      if(restPath == end)
+         break;
+      /* Split the rest of the path, past the '/' at restPath, once
+         these components are used up. */
+      restPath++;
    }
 
-
-   free(copyPath);
-
    /* If the tree was initially empty, let this inserted path be the
             entire data structure. */
    if(parent == NULL) {
@@ -165,30 +241,74 @@ static int FT_insertRestOfPath(char* path, Node parent, boolean type,
       count = newCount;
       return SUCCESS;
    }
+   /* A path that is parent's with slashes added names parent. */
+   else if(firstNew == NULL)
+      return ALREADY_IN_TREE;
    else {
       /* Link the added path to the data structure. */
       result = HANDLER_linkParentToChild(parent, firstNew);
       if(result == SUCCESS)
-         count += newCount;
-      else
-         (void) Node_destroy(firstNew);
+         (void) __sync_fetch_and_add(&count, newCount);
       return result;
    }
 }
 
-/* Removes the directory hierarchy rooted at path starting from Node
-   curr. If curr is the data structure's root, root becomes NULL.
+/* Inserts a new path into the tree rooted at parent, with leaf being
+   a node with path path, the pathLength bytes at path, contents
+   contents, length length, and type as its value for isFile. parent
+   must be the Node that FT_traversePath returned for path.
+   If the root of the data structure is NULL, then inserts this path's
+   first node as the root.
+   If the parent is NULL but there exists a root in the tree, return
+   CONFLICTING_PATH.
+   If the given path exists, return ALREADY_IN_TREE.
+   If parent is a file, return NOT_A_DIRECTORY.
+   Else, return what FT_insertBelow returns for the rest of path. */
+static int FT_insertRestOfPath(const char* path, size_t pathLength,
+                               Node parent, boolean type,
+                               void *contents, size_t length) {
+   const char* restPath = path;
+
+   assert(path != NULL);
+
+   if(parent == NULL){
+      if(root != NULL) {
+      /* If there is a root, but the parent is NULL,
+         then it is a conflicting path error.
+         NOTE: ft.h stipulates we should return NO_SUCH_PATH
+         instead if this happens for a file, but the checker
+         suggests the more generally valid approach we use here. */
+      return CONFLICTING_PATH;
+      }
+   }
+   else if(FT_isWholePath(parent, pathLength))
+      return ALREADY_IN_TREE;
+   else if (Node_isFile(parent))
+      return NOT_A_DIRECTORY;
+   else {
+      /* If there are no path issues, restPath denotes the portion of
+         the path which remains to be added to the data structure. */
+      restPath += Node_getPathLength(parent) + 1;
+   }
+
+   return FT_insertBelow(parent, restPath, path + pathLength, type,
+                         contents, length);
+}
+
+/* Removes the directory hierarchy rooted at a path of pathLength
+   bytes starting from Node curr, which FT_traversePath returned for
+   it. If curr is the data structure's root, root becomes NULL.
    Returns NO_SUCH_PATH if curr is not the Node for path,
    otherwise SUCCESS. */
-static int FT_rmPathAt(char* path, Node curr) {
+static int FT_rmPathAt(size_t pathLength, Node curr) {
    Node parent;
 
-   assert(path != NULL);
    assert(curr != NULL);
 
    parent = Node_getParent(curr);
 
-   if(!strcmp(path, Node_getPath(curr))) {
+   if(FT_isWholePath(curr, pathLength)) {
+      (void) __atomic_fetch_add(&epoch, 1, __ATOMIC_RELEASE);
       if(parent == NULL){
          root = NULL;
       }
@@ -196,7 +316,7 @@ static int FT_rmPathAt(char* path, Node curr) {
          Node_unlinkChild(parent, curr);
 
       if(curr != NULL) {
-         count -= Node_destroy(curr);
+         (void) __sync_fetch_and_sub(&count, Node_destroy(curr));
       }
 
       return SUCCESS;
@@ -207,164 +327,269 @@ static int FT_rmPathAt(char* path, Node curr) {
 
 /* see ft.h for specification */
 int FT_insertDir(char *path){
+   assert(path != NULL);
+
+   return FT_insertDirN(path, strlen(path));
+}
+
+/* see ft.h for specification */
+int FT_insertDirN(const char *path, size_t pathLength){
    Node curr;
    int result;
 
    assert(path != NULL);
 
+   STATS_OP_BEGIN(FT_OP_INSERT_DIR);
+
    if(!isInitialized)
-      return INITIALIZATION_ERROR;
-   curr = HANDLER_traversePathFrom(path, root);
-   result = FT_insertRestOfPath(path, curr, FALSE, NULL, 0);
+      result = INITIALIZATION_ERROR;
+   else {
+      curr = FT_traversePath(path, pathLength, FALSE);
+      result = FT_insertRestOfPath(path, pathLength, curr, FALSE, NULL,
+                                   0);
+   }
 
+   STATS_OP_END(FT_OP_INSERT_DIR);
+   TRACE_RECORD(FT_OP_INSERT_DIR, path, pathLength, 0, result);
    return result;
 }
 
 /* see ft.h for specification */
 boolean FT_containsDir(char *path){
+   assert(path != NULL);
+
+   return FT_containsDirN(path, strlen(path));
+}
+
+/* see ft.h for specification */
+boolean FT_containsDirN(const char *path, size_t pathLength){
    Node curr;
    boolean result;
 
    assert(path != NULL);
 
-   if(!isInitialized)
-      return FALSE;
+   STATS_OP_BEGIN(FT_OP_CONTAINS_DIR);
 
-   curr = HANDLER_traversePathFrom(path, root);
+   if(!isInitialized)
+      curr = NULL;
+   else
+      curr = FT_traversePath(path, pathLength, FALSE);
 
-   if(curr == NULL)
-      result = FALSE;
-   else if(strcmp(path, Node_getPath(curr)))
+   if(!FT_isWholePath(curr, pathLength))
       result = FALSE;
    else
       result = !Node_isFile(curr);
 
+   STATS_OP_END(FT_OP_CONTAINS_DIR);
+   TRACE_RECORD(FT_OP_CONTAINS_DIR, path, pathLength, 0, result);
    return result;
 }
 
 /* see ft.h for specification */
 int FT_rmDir(char *path){
+   assert(path != NULL);
+
+   return FT_rmDirN(path, strlen(path));
+}
+
+/* see ft.h for specification */
+int FT_rmDirN(const char *path, size_t pathLength){
    Node curr;
    int result;
 
    assert(path != NULL);
 
+   STATS_OP_BEGIN(FT_OP_RM_DIR);
+
    if(!isInitialized)
       result = INITIALIZATION_ERROR;
 
-   curr = HANDLER_traversePathFrom(path, root);
+   curr = FT_traversePath(path, pathLength, FALSE);
    if(curr == NULL)
       result = NO_SUCH_PATH;
    else if (Node_isFile(curr))
       result = NOT_A_DIRECTORY;
    else
-      result = FT_rmPathAt(path, curr);
+      result = FT_rmPathAt(pathLength, curr);
 
+   STATS_OP_END(FT_OP_RM_DIR);
+   TRACE_RECORD(FT_OP_RM_DIR, path, pathLength, 0, result);
    return result;
 }
 
 /* see ft.h for specification */
 int FT_insertFile(char *path, void *contents, size_t length){
+   assert(path != NULL);
+
+   return FT_insertFileN(path, strlen(path), contents, length);
+}
+
+/* see ft.h for specification */
+int FT_insertFileN(const char *path, size_t pathLength,
+                   void *contents, size_t length){
    Node curr;
    int result;
 
    assert(path != NULL);
 
+   STATS_OP_BEGIN(FT_OP_INSERT_FILE);
+
    if(!isInitialized)
-      return INITIALIZATION_ERROR;
-   curr = HANDLER_traversePathFrom(path, root);
-   result = FT_insertRestOfPath(path, curr, TRUE, contents, length);
+      result = INITIALIZATION_ERROR;
+   else {
+      curr = FT_traversePath(path, pathLength, TRUE);
+      result = FT_insertRestOfPath(path, pathLength, curr, TRUE,
+                                   contents, length);
+   }
+
+   STATS_OP_END(FT_OP_INSERT_FILE);
+   TRACE_RECORD(FT_OP_INSERT_FILE, path, pathLength, length, result);
    return result;
 }
 
 /* see ft.h for specification */
 boolean FT_containsFile(char *path){
+   assert(path != NULL);
+
+   return FT_containsFileN(path, strlen(path));
+}
+
+/* see ft.h for specification */
+boolean FT_containsFileN(const char *path, size_t pathLength){
    Node curr;
    boolean result;
 
    assert(path != NULL);
 
+   STATS_OP_BEGIN(FT_OP_CONTAINS_FILE);
+
    if(!isInitialized)
       result = FALSE;
 
-   curr = HANDLER_traversePathFrom(path, root);
+   curr = FT_traversePath(path, pathLength, TRUE);
 
-   if(curr == NULL)
-      result = FALSE;
-   else if(strcmp(path, Node_getPath(curr)))
+   if(!FT_isWholePath(curr, pathLength))
       result = FALSE;
    else
       result = Node_isFile(curr);
 
+   STATS_OP_END(FT_OP_CONTAINS_FILE);
+   TRACE_RECORD(FT_OP_CONTAINS_FILE, path, pathLength, 0, result);
    return result;
 }
 
 /* see ft.h for specification */
 int FT_rmFile(char *path){
+   assert(path != NULL);
+
+   return FT_rmFileN(path, strlen(path));
+}
+
+/* see ft.h for specification */
+int FT_rmFileN(const char *path, size_t pathLength){
    Node curr;
    int result;
 
    assert(path != NULL);
 
+   STATS_OP_BEGIN(FT_OP_RM_FILE);
+
    if(isInitialized)
       result = INITIALIZATION_ERROR;
 
-   curr = HANDLER_traversePathFrom(path, root);
+   curr = FT_traversePath(path, pathLength, TRUE);
    if(curr == NULL)
       result = NO_SUCH_PATH;
    else if (!Node_isFile(curr))
       result = NOT_A_FILE;
    else
-      result = FT_rmPathAt(path, curr);
+      result = FT_rmPathAt(pathLength, curr);
 
+   STATS_OP_END(FT_OP_RM_FILE);
+   TRACE_RECORD(FT_OP_RM_FILE, path, pathLength, 0, result);
    return result;
 }
 
 /* see ft.h for specification */
 void *FT_getFileContents(char *path){
+   assert(path != NULL);
+
+   return FT_getFileContentsN(path, strlen(path));
+}
+
+/* see ft.h for specification */
+void *FT_getFileContentsN(const char *path, size_t pathLength){
    Node curr;
    void *result;
 
    assert(path != NULL);
 
+   STATS_OP_BEGIN(FT_OP_GET_FILE_CONTENTS);
+
    if(!isInitialized)
       result = NULL;
 
-   curr = HANDLER_traversePathFrom(path, root);
+   curr = FT_traversePath(path, pathLength, TRUE);
 
-   if(curr == NULL || strcmp(path, Node_getPath(curr))
-      || !Node_isFile(curr))
+   if(!FT_isWholePath(curr, pathLength) || !Node_isFile(curr))
       result = NULL;
    else
       result = Node_getContents(curr);
 
+   STATS_OP_END(FT_OP_GET_FILE_CONTENTS);
+   TRACE_RECORD(FT_OP_GET_FILE_CONTENTS, path, pathLength, 0,
+                !FT_isWholePath(curr, pathLength) || !Node_isFile(curr)
+                ? NO_SUCH_PATH : SUCCESS);
    return result;
 }
 
 /* see ft.h for specification */
 void *FT_replaceFileContents(char *path, void *newContents,
                              size_t newLength){
+   assert(path != NULL);
+
+   return FT_replaceFileContentsN(path, strlen(path), newContents,
+                                  newLength);
+}
+
+/* see ft.h for specification */
+void *FT_replaceFileContentsN(const char *path, size_t pathLength,
+                              void *newContents, size_t newLength){
    Node curr;
    void *result;
 
    assert(path != NULL);
 
+   STATS_OP_BEGIN(FT_OP_REPLACE_FILE_CONTENTS);
+
    if(!isInitialized)
       result = NULL;
 
-   curr = HANDLER_traversePathFrom(path, root);
+   curr = FT_traversePath(path, pathLength, TRUE);
 
-   if(curr == NULL || strcmp(path, Node_getPath(curr))
-      || !Node_isFile(curr))
+   if(!FT_isWholePath(curr, pathLength) || !Node_isFile(curr))
       result = NULL;
    else
       result = Node_setContents(curr, newContents, newLength);
 
+   STATS_OP_END(FT_OP_REPLACE_FILE_CONTENTS);
+   TRACE_RECORD(FT_OP_REPLACE_FILE_CONTENTS, path, pathLength,
+                newLength,
+                !FT_isWholePath(curr, pathLength) || !Node_isFile(curr)
+                ? NO_SUCH_PATH : SUCCESS);
    return result;
 }
 
 /* see ft.h for specification */
 int FT_stat(char *path, boolean *type, size_t *length){
+   assert(path != NULL);
+
+   return FT_statN(path, strlen(path), type, length);
+}
+
+/* see ft.h for specification */
+int FT_statN(const char *path, size_t pathLength, boolean *type,
+             size_t *length){
    Node curr;
    boolean result;
 
@@ -372,14 +597,14 @@ int FT_stat(char *path, boolean *type, size_t *length){
    assert(type != NULL);
    assert(length != NULL);
 
+   STATS_OP_BEGIN(FT_OP_STAT);
+
    if(!isInitialized)
       result = INITIALIZATION_ERROR ;
 
-   curr = HANDLER_traversePathFrom(path, root);
+   curr = FT_traversePath(path, pathLength, FALSE);
 
-   if(curr == NULL)
-      result = NO_SUCH_PATH;
-   else if(strcmp(path, Node_getPath(curr)))
+   if(!FT_isWholePath(curr, pathLength))
       result = NO_SUCH_PATH;
    else {
       if(Node_isFile(curr)){
@@ -391,6 +616,458 @@ int FT_stat(char *path, boolean *type, size_t *length){
       result = SUCCESS;
    }
 
+   STATS_OP_END(FT_OP_STAT);
+   TRACE_RECORD(FT_OP_STAT, path, pathLength,
+                (int) result == SUCCESS && *type ? *length : 0, result);
+   return result;
+}
+
+/* see ft.h for specification */
+int FT_ensureDir(char *path){
+   assert(path != NULL);
+
+   return FT_ensureDirN(path, strlen(path));
+}
+
+/* see ft.h for specification */
+int FT_ensureDirN(const char *path, size_t pathLength){
+   Node curr;
+   int result;
+
+   assert(path != NULL);
+
+   STATS_OP_BEGIN(FT_OP_ENSURE_DIR);
+
+   if(!isInitialized)
+      result = INITIALIZATION_ERROR;
+   else {
+      /* The Node that the one traversal stops at is either the
+         directory itself or the one below which the rest of it is
+         created, with no second descent. */
+      curr = FT_traversePath(path, pathLength, FALSE);
+      if(FT_isWholePath(curr, pathLength) && Node_isFile(curr))
+         result = NOT_A_DIRECTORY;
+      else {
+         result = FT_insertRestOfPath(path, pathLength, curr, FALSE,
+                                      NULL, 0);
+         if(result == ALREADY_IN_TREE)
+            result = SUCCESS;
+      }
+   }
+
+   STATS_OP_END(FT_OP_ENSURE_DIR);
+   TRACE_RECORD(FT_OP_ENSURE_DIR, path, pathLength, 0, result);
+   return result;
+}
+
+/* see ft.h for specification */
+int FT_upsertFile(char *path, void *contents, size_t length,
+                  void **pOldContents){
+   assert(path != NULL);
+
+   return FT_upsertFileN(path, strlen(path), contents, length,
+                         pOldContents);
+}
+
+/* see ft.h for specification */
+int FT_upsertFileN(const char *path, size_t pathLength, void *contents,
+                   size_t length, void **pOldContents){
+   Node curr;
+   void *oldContents = NULL;
+   int result;
+
+   assert(path != NULL);
+
+   STATS_OP_BEGIN(FT_OP_UPSERT_FILE);
+
+   if(!isInitialized)
+      result = INITIALIZATION_ERROR;
+   else {
+      curr = FT_traversePath(path, pathLength, TRUE);
+      if(FT_isWholePath(curr, pathLength)) {
+         if(Node_isFile(curr)) {
+            oldContents = Node_setContents(curr, contents, length);
+            result = SUCCESS;
+         }
+         else
+            result = NOT_A_FILE;
+      }
+      else {
+         result = FT_insertRestOfPath(path, pathLength, curr, TRUE,
+                                      contents, length);
+         /* a path that names a directory, with slashes added */
+         if(result == ALREADY_IN_TREE)
+            result = NOT_A_FILE;
+      }
+   }
+
+   if(pOldContents != NULL)
+      *pOldContents = oldContents;
+
+   STATS_OP_END(FT_OP_UPSERT_FILE);
+   TRACE_RECORD(FT_OP_UPSERT_FILE, path, pathLength, length, result);
+   return result;
+}
+
+/* Stores in *result what FT_stat finds at path, the pathLength bytes
+   at path, given curr, the Node that FT_traversePath returned for
+   path, and records it as an FT_stat call. */
+static void FT_setStatResult(struct FT_statResult *result, Node curr,
+                             const char *path, size_t pathLength) {
+   if(FT_isWholePath(curr, pathLength)) {
+      result->status = SUCCESS;
+      result->type = Node_isFile(curr);
+      result->length = result->type ? Node_getLength(curr) : 0;
+   }
+   else {
+      result->status = NO_SUCH_PATH;
+      result->type = FALSE;
+      result->length = 0;
+   }
+   TRACE_RECORD(FT_OP_STAT, path, pathLength, result->length,
+                result->status);
+}
+
+/* see ft.h for specification */
+int FT_statMany(char *paths[], size_t n,
+                struct FT_statResult results[]){
+   struct Path_component *queries;
+   struct Path_component *query;
+   size_t *order;
+   Node curr = NULL;
+   size_t i;
+
+   assert(paths != NULL || n == 0);
+   assert(results != NULL || n == 0);
+
+   STATS_OP_BEGIN(FT_OP_STAT_MANY);
+
+   if(!isInitialized) {
+      STATS_OP_END(FT_OP_STAT_MANY);
+      return INITIALIZATION_ERROR;
+   }
+   if(n == 0) {
+      STATS_OP_END(FT_OP_STAT_MANY);
+      return SUCCESS;
+   }
+
+   /* the paths and the order to look them up in share one block */
+   queries = malloc(n * (sizeof(struct Path_component)
+                         + sizeof(size_t)));
+   if(queries == NULL) {
+      STATS_OP_END(FT_OP_STAT_MANY);
+      return MEMORY_ERROR;
+   }
+   STATS_ADD(mallocs[FT_SUB_FT], 1);
+   order = (size_t *) (queries + n);
+
+   for(i = 0; i < n; i++) {
+      assert(paths[i] != NULL);
+      queries[i].name = paths[i];
+      queries[i].length = strlen(paths[i]);
+      order[i] = i;
+   }
+   Path_sort(queries, order, n);
+
+   /* In sorted order, the paths that share a prefix are together, so
+      each one climbs from the Node where the one before it ended to
+      their deepest common Node, and descends only the rest of the
+      way. */
+   for(i = 0; i < n; i++) {
+      query = &queries[order[i]];
+      curr = FT_climbToPrefix(curr, query->name, query->length);
+      if(curr == NULL)
+         curr = FT_traversePath(query->name, query->length, FALSE);
+      else {
+         /* FT_traversePath counts the lookups that it does */
+         STATS_ADD(lookups, 1);
+         curr = HANDLER_descendFrom(query->name, query->length, curr,
+                                    FALSE);
+      }
+
+      FT_setStatResult(&results[order[i]], curr, query->name,
+                       query->length);
+   }
+
+   free(queries);
+   STATS_ADD(frees[FT_SUB_FT], 1);
+   STATS_OP_END(FT_OP_STAT_MANY);
+   return SUCCESS;
+}
+
+/* see ft.h for specification */
+int FT_statBatch(char *paths[], size_t n,
+                 struct FT_statResult results[]){
+   struct Path_component queries[STAT_BLOCK];
+   Node found[STAT_BLOCK];
+   size_t count;
+   size_t i;
+   size_t j;
+
+   assert(paths != NULL || n == 0);
+   assert(results != NULL || n == 0);
+
+   STATS_OP_BEGIN(FT_OP_STAT_BATCH);
+
+   if(!isInitialized) {
+      STATS_OP_END(FT_OP_STAT_BATCH);
+      return INITIALIZATION_ERROR;
+   }
+
+   for(i = 0; i < n; i += count) {
+      count = n - i < STAT_BLOCK ? n - i : STAT_BLOCK;
+      for(j = 0; j < count; j++) {
+         assert(paths[i + j] != NULL);
+         queries[j].name = paths[i + j];
+         queries[j].length = strlen(paths[i + j]);
+      }
+      STATS_ADD(lookups, count);
+      HANDLER_traverseMany(queries, count, root, FALSE, found);
+      for(j = 0; j < count; j++)
+         FT_setStatResult(&results[i + j], found[j], queries[j].name,
+                          queries[j].length);
+   }
+
+   STATS_OP_END(FT_OP_STAT_BATCH);
+   return SUCCESS;
+}
+
+/* Returns how many bytes of a path relative to dir that
+   HANDLER_descendRelative matched when it returned curr. */
+static size_t FT_relativeLength(Node dir, Node curr) {
+   if(curr == dir)
+      return 0;
+   return Node_getPathLength(curr) - Node_getPathLength(dir) - 1;
+}
+
+/* Records a call to op, which stands for a call on name, the
+   nameLength bytes at name, relative to dir, with the whole path that
+   it names, so that the trace holds only calls that take a whole
+   path. Records name alone if dir is NULL, for a stale handle, or if
+   there is not enough memory to join the two. */
+static void FT_recordAt(enum FT_op op, Node dir, const char *name,
+                        size_t nameLength, size_t length, int result) {
+   char *path;
+   size_t dirLength;
+
+   if(dir == NULL) {
+      Trace_record(op, name, nameLength, length, result);
+      return;
+   }
+
+   dirLength = Node_getPathLength(dir);
+   path = malloc(dirLength + 1 + nameLength);
+   if(path == NULL) {
+      Trace_record(op, name, nameLength, length, result);
+      return;
+   }
+   STATS_ADD(mallocs[FT_SUB_FT], 1);
+   memcpy(path, Node_getPath(dir), dirLength);
+   if(nameLength != 0) {
+      path[dirLength] = '/';
+      memcpy(path + dirLength + 1, name, nameLength);
+      dirLength += 1 + nameLength;
+   }
+   Trace_record(op, path, dirLength, length, result);
+   free(path);
+   STATS_ADD(frees[FT_SUB_FT], 1);
+}
+
+/* see ft.h for specification */
+int FT_open(char *path, struct FT_handle *pHandle){
+   Node curr;
+   size_t pathLength;
+   int result;
+
+   assert(path != NULL);
+   assert(pHandle != NULL);
+
+   STATS_OP_BEGIN(FT_OP_OPEN);
+
+   pathLength = strlen(path);
+   if(!isInitialized)
+      result = INITIALIZATION_ERROR;
+   else {
+      curr = FT_traversePath(path, pathLength, FALSE);
+      if(!FT_isWholePath(curr, pathLength))
+         result = NO_SUCH_PATH;
+      else
+         result = Handle_open(curr, pHandle);
+   }
+
+   STATS_OP_END(FT_OP_OPEN);
+   return result;
+}
+
+/* see ft.h for specification */
+int FT_close(struct FT_handle handle){
+   Node curr;
+   int result;
+
+   STATS_OP_BEGIN(FT_OP_CLOSE);
+
+   if(!isInitialized)
+      result = INITIALIZATION_ERROR;
+   else if((curr = Handle_get(handle)) == NULL)
+      result = NO_SUCH_PATH;
+   else {
+      Handle_close(curr);
+      result = SUCCESS;
+   }
+
+   STATS_OP_END(FT_OP_CLOSE);
+   return result;
+}
+
+/* see ft.h for specification */
+int FT_insertFileAt(struct FT_handle dir, char *name, void *contents,
+                    size_t length){
+   Node parent = NULL;
+   Node curr;
+   size_t nameLength;
+   size_t matched;
+   int result;
+
+   assert(name != NULL);
+
+   STATS_OP_BEGIN(FT_OP_INSERT_FILE_AT);
+
+   nameLength = strlen(name);
+   if(!isInitialized)
+      result = INITIALIZATION_ERROR;
+   else if((parent = Handle_get(dir)) == NULL)
+      result = NO_SUCH_PATH;
+   else if(Node_isFile(parent))
+      result = NOT_A_DIRECTORY;
+   else {
+      STATS_ADD(lookups, 1);
+      curr = HANDLER_descendRelative(name, nameLength, parent, TRUE);
+      matched = FT_relativeLength(parent, curr);
+      if(matched == nameLength)
+         result = ALREADY_IN_TREE;
+      else if(Node_isFile(curr))
+         result = NOT_A_DIRECTORY;
+      else
+         result = FT_insertBelow(curr,
+                                 curr == parent ? name
+                                                : name + matched + 1,
+                                 name + nameLength, TRUE, contents,
+                                 length);
+   }
+
+   STATS_OP_END(FT_OP_INSERT_FILE_AT);
+   if(TRACE_IS_ON())
+      FT_recordAt(FT_OP_INSERT_FILE, parent, name, nameLength, length,
+                  result);
+   return result;
+}
+
+/* see ft.h for specification */
+int FT_statAt(struct FT_handle dir, char *name, boolean *type,
+              size_t *length){
+   Node parent = NULL;
+   Node curr;
+   size_t nameLength;
+   int result;
+
+   assert(name != NULL);
+   assert(type != NULL);
+   assert(length != NULL);
+
+   STATS_OP_BEGIN(FT_OP_STAT_AT);
+
+   nameLength = strlen(name);
+   if(!isInitialized)
+      result = INITIALIZATION_ERROR;
+   else if((parent = Handle_get(dir)) == NULL)
+      result = NO_SUCH_PATH;
+   else {
+      STATS_ADD(lookups, 1);
+      curr = HANDLER_descendRelative(name, nameLength, parent, FALSE);
+      if(FT_relativeLength(parent, curr) != nameLength)
+         result = NO_SUCH_PATH;
+      else {
+         *type = Node_isFile(curr);
+         if(*type)
+            *length = Node_getLength(curr);
+         result = SUCCESS;
+      }
+   }
+
+   STATS_OP_END(FT_OP_STAT_AT);
+   if(TRACE_IS_ON())
+      FT_recordAt(FT_OP_STAT, parent, name, nameLength,
+                  result == SUCCESS && *type ? *length : 0, result);
+   return result;
+}
+
+/* see ft.h for specification */
+void *FT_getFileContentsById(struct FT_handle file){
+   Node curr = NULL;
+   void *result = NULL;
+
+   STATS_OP_BEGIN(FT_OP_GET_FILE_CONTENTS_BY_ID);
+
+   if(isInitialized) {
+      curr = Handle_get(file);
+      if(curr != NULL && Node_isFile(curr))
+         result = Node_getContents(curr);
+   }
+
+   STATS_OP_END(FT_OP_GET_FILE_CONTENTS_BY_ID);
+   if(curr != NULL)
+      TRACE_RECORD(FT_OP_GET_FILE_CONTENTS, Node_getPath(curr),
+                   Node_getPathLength(curr), 0,
+                   Node_isFile(curr) ? SUCCESS : NO_SUCH_PATH);
+   return result;
+}
+
+/* see ft.h for specification */
+int FT_listAt(struct FT_handle dir, char **pList){
+   Node curr;
+   Node child;
+   size_t numChildren;
+   size_t totalLength = 1;
+   size_t childID;
+   char *list;
+   char *end;
+   int result;
+
+   assert(pList != NULL);
+
+   STATS_OP_BEGIN(FT_OP_LIST_AT);
+
+   if(!isInitialized)
+      result = INITIALIZATION_ERROR;
+   else if((curr = Handle_get(dir)) == NULL)
+      result = NO_SUCH_PATH;
+   else if(Node_isFile(curr))
+      result = NOT_A_DIRECTORY;
+   else {
+      numChildren = Node_getNumChildren(curr);
+      for(childID = 0; childID < numChildren; childID++)
+         totalLength += Node_getNameLength(Node_getChild(curr, childID))
+            + 1;
+
+      list = malloc(totalLength);
+      if(list == NULL)
+         result = MEMORY_ERROR;
+      else {
+         STATS_ADD(mallocs[FT_SUB_FT], 1);
+         end = list;
+         for(childID = 0; childID < numChildren; childID++) {
+            child = Node_getChild(curr, childID);
+            memcpy(end, Node_getName(child), Node_getNameLength(child));
+            end += Node_getNameLength(child);
+            *end++ = '\n';
+         }
+         *end = '\0';
+         *pList = list;
+         result = SUCCESS;
+      }
+   }
+
+   STATS_OP_END(FT_OP_LIST_AT);
    return result;
 }
 
@@ -398,6 +1075,8 @@ int FT_stat(char *path, boolean *type, size_t *length){
 int FT_init(void){
    int result;
 
+   STATS_OP_BEGIN(FT_OP_INIT);
+
    if(isInitialized)
       result = INITIALIZATION_ERROR;
    else {
@@ -406,6 +1085,9 @@ int FT_init(void){
       count = 0;
       result = SUCCESS;
    }
+
+   STATS_OP_END(FT_OP_INIT);
+   TRACE_RECORD(FT_OP_INIT, NULL, 0, 0, result);
    return result;
 }
 
@@ -413,37 +1095,60 @@ int FT_init(void){
 int FT_destroy(void){
    int result;
 
+   STATS_OP_BEGIN(FT_OP_DESTROY);
+
    if(!isInitialized)
       result = INITIALIZATION_ERROR;
    else if(root == NULL)
       result = SUCCESS;
    else {
-      FT_rmPathAt((char*)Node_getPath(root), root);
+      FT_rmPathAt(Node_getPathLength(root), root);
       root = NULL;
       count = 0;
       isInitialized = FALSE;
       result = SUCCESS;
    }
 
+   STATS_OP_END(FT_OP_DESTROY);
+   TRACE_RECORD(FT_OP_DESTROY, NULL, 0, 0, result);
    return result;
 }
 
-/* Performs a pre-order traversal of the tree rooted at n,
-   inserting each payload to DynArray_T d beginning at index i.
-   Returns the next unused index in d after the insertion(s). */
-static size_t FT_preOrderTraversal(Node n, DynArray_T d, size_t i) {
-   size_t c;
+/* A DynArray being filled by FT_preOrderTraversal, and the index of
+   the next element of it to set. */
+struct traversal {
+   DynArray_T d;
+   size_t i;
+};
+
+/* Sets the next element of the DynArray of *pvTraversal, a struct
+   traversal, to the path of n. Returns TRUE to go on to the next
+   Node. */
+static boolean FT_addPath(Node n, void *pvTraversal) {
+   struct traversal *pTraversal = pvTraversal;
+
+   assert(pTraversal != NULL);
+
+   (void) DynArray_set(pTraversal->d, pTraversal->i++,
+                       Node_getPath(n));
+   return TRUE;
+}
+
+/* Performs a pre-order traversal of the tree rooted at n (which may
+   be NULL), setting the elements of DynArray_T d, from index 0, to the
+   payloads visited. Returns SUCCESS, or MEMORY_ERROR if there is not
+   enough memory for the traversal. */
+static int FT_preOrderTraversal(Node n, DynArray_T d) {
+   struct traversal traversal;
 
    assert(d != NULL);
 
-   if(n != NULL) {
-      (void) DynArray_set(d, i, Node_getPath(n));
-      i++;
-      for(c = 0; c < Node_getNumChildren(n); c++)
-         i = FT_preOrderTraversal(Node_getChild(n, c), d, i);
-   }
+   if(n == NULL)
+      return SUCCESS;
 
-   return i;
+   traversal.d = d;
+   traversal.i = 0;
+   return Node_preOrder(n, FT_addPath, &traversal);
 }
 
 /* see ft.h for specification */
@@ -451,27 +1156,159 @@ char *FT_toString(){
    DynArray_T nodes;
    size_t totalStrlen = 1;
    char* result = NULL;
+   char* end;
 
-   if(!isInitialized)
+   STATS_OP_BEGIN(FT_OP_TO_STRING);
+
+   if(!isInitialized) {
+      STATS_OP_END(FT_OP_TO_STRING);
+      TRACE_RECORD(FT_OP_TO_STRING, NULL, 0, 0, INITIALIZATION_ERROR);
       return NULL;
+   }
 
    nodes = DynArray_new(count);
-   (void) FT_preOrderTraversal(root, nodes, 0);
+   if(nodes == NULL || FT_preOrderTraversal(root, nodes) != SUCCESS) {
+      if(nodes != NULL)
+         DynArray_free(nodes);
+      STATS_OP_END(FT_OP_TO_STRING);
+      TRACE_RECORD(FT_OP_TO_STRING, NULL, 0, 0, MEMORY_ERROR);
+      return NULL;
+   }
 
-   DynArray_map(nodes, (void (*)(void *, void*)) HANDLER_strlenAccumulate ,
+   DynArray_map(nodes,
+                (void (*)(void *, void*)) HANDLER_strlenAccumulate,
                 (void*) &totalStrlen);
 
    result = malloc(totalStrlen);
    if(result == NULL) {
       DynArray_free(nodes);
+      STATS_OP_END(FT_OP_TO_STRING);
+      TRACE_RECORD(FT_OP_TO_STRING, NULL, 0, 0, MEMORY_ERROR);
       return NULL;
    }
+   STATS_ADD(mallocs[FT_SUB_FT], 1);
 
    *result = '\0';
+   end = result;
 
-   DynArray_map(nodes, (void (*)(void *, void*)) HANDLER_strcatAccumulate,
-                (void *) result);
+   DynArray_map(nodes,
+                (void (*)(void *, void*)) HANDLER_strcatAccumulate,
+                (void *) &end);
 
    DynArray_free(nodes);
+   STATS_OP_END(FT_OP_TO_STRING);
+   TRACE_RECORD(FT_OP_TO_STRING, NULL, 0, 0, SUCCESS);
    return result;
 }
+
+/* see ft.h for specification */
+void FT_getStats(struct FT_stats *pStats){
+   assert(pStats != NULL);
+
+   Stats_read(pStats);
+}
+
+/* see ft.h for specification */
+void FT_resetStats(void){
+   Stats_reset();
+}
+
+/* see ft.h for specification */
+size_t FT_getLatency(enum FT_op op, double quantile){
+   struct Stats_histogram histogram;
+
+   assert(op < FT_NUM_OPS);
+   assert(quantile >= 0 && quantile <= 1);
+
+   Stats_readLatency(op, &histogram);
+   return Stats_percentile(&histogram, quantile);
+}
+
+/* see ft.h for specification */
+void FT_dumpLatency(FILE *stream, boolean asJSON){
+   assert(stream != NULL);
+
+   Stats_dumpLatency(stream, asJSON);
+}
+
+/* Adds the memory of n to *pvMemory, a struct FT_memory. Returns TRUE
+   to go on to the next Node. */
+static boolean FT_addNodeMemory(Node n, void *pvMemory) {
+   Node_addMemory(n, pvMemory);
+   return TRUE;
+}
+
+/* Adds the memory of every Node in the tree rooted at n (which may be
+   NULL) to *pMemory. Returns SUCCESS, or MEMORY_ERROR if there is not
+   enough memory to walk the tree. */
+static int FT_addMemoryFrom(Node n, struct FT_memory *pMemory) {
+   assert(pMemory != NULL);
+
+   if(n == NULL)
+      return SUCCESS;
+   return Node_preOrder(n, FT_addNodeMemory, pMemory);
+}
+
+/* see ft.h for specification */
+int FT_memoryReport(struct FT_memory *pMemory){
+   assert(pMemory != NULL);
+
+   if(!isInitialized)
+      return INITIALIZATION_ERROR;
+
+   memset(pMemory, 0, sizeof(*pMemory));
+   if(FT_addMemoryFrom(root, pMemory) != SUCCESS)
+      return MEMORY_ERROR;
+
+   pMemory->totalBytes = pMemory->nodeBytes + pMemory->pathBytes
+      + pMemory->childHeaderBytes + pMemory->childArrayBytes
+      + pMemory->childArraySlackBytes + pMemory->indexBytes
+      + pMemory->filterBytes;
+   if(pMemory->nodes != 0)
+      pMemory->bytesPerNode = pMemory->totalBytes / pMemory->nodes;
+
+   return SUCCESS;
+}
+
+/* see ft.h for specification */
+boolean FT_validate(void){
+   return Checker_FT_isValid(isInitialized, root, count);
+}
+
+/* see ft.h for specification */
+int FT_setEngine(const char *name){
+   const struct Engine* engine;
+
+   assert(name != NULL);
+
+   if(isInitialized)
+      return INITIALIZATION_ERROR;
+
+   engine = Engine_lookup(name);
+   if(engine == NULL)
+      return NO_SUCH_PATH;
+
+   Node_setEngine(engine);
+   return SUCCESS;
+}
+
+/* see ft.h for specification */
+const char *FT_getEngineName(size_t engineID){
+   const struct Engine* engine = Engine_get(engineID);
+
+   if(engine == NULL)
+      return NULL;
+   return engine->name;
+}
+
+/* see ft.h for specification */
+int FT_startTrace(FILE *stream){
+   assert(stream != NULL);
+
+   return Trace_start(stream);
+}
+
+/* see ft.h for specification */
+int FT_stopTrace(void){
+   return Trace_stop();
+}
@@ -10,11 +10,77 @@
   A File Tree is a representation of a hierarchy of directories and
   files. The File Tree is rooted at a directory, directories may
   be inner nodes or leaves, and files are always leaves.
+
+  The File Tree does no locking. Calls from several threads may run
+  at once only if the client serializes every pair of calls that
+  work below the same child of the root and of which at least one
+  changes the tree, and no such child is being inserted or removed;
+  the count of Nodes is updated atomically, so calls in different
+  subtrees do not disturb each other. Calls that only read the tree
+  (FT_containsDir, FT_containsFile, FT_getFileContents, FT_stat,
+  FT_statMany, FT_statBatch, FT_statAt, FT_getFileContentsById,
+  FT_listAt and their N forms) need not be serialized with one
+  another anywhere: what they keep between calls, their counters and
+  where their last lookup ended, is kept per thread. The one count
+  that lookups share across subtrees is that of removals, which is
+  global and read atomically: a removal in any subtree makes the next
+  lookup of every thread start again from the root, so removals in
+  one subtree slow down lookups in the others a little.
 */
 
 #include <stddef.h>
+#include <stdio.h>
 #include "a4def.h"
 
+/* The FT entry points, as they are identified in FT_stats. */
+enum FT_op { FT_OP_INSERT_DIR, FT_OP_CONTAINS_DIR, FT_OP_RM_DIR,
+             FT_OP_INSERT_FILE, FT_OP_CONTAINS_FILE, FT_OP_RM_FILE,
+             FT_OP_GET_FILE_CONTENTS, FT_OP_REPLACE_FILE_CONTENTS,
+             FT_OP_STAT, FT_OP_INIT, FT_OP_DESTROY, FT_OP_TO_STRING,
+             FT_OP_ENSURE_DIR, FT_OP_UPSERT_FILE, FT_OP_STAT_MANY,
+             FT_OP_STAT_BATCH, FT_OP_OPEN, FT_OP_CLOSE,
+             FT_OP_INSERT_FILE_AT, FT_OP_STAT_AT,
+             FT_OP_GET_FILE_CONTENTS_BY_ID, FT_OP_LIST_AT, FT_NUM_OPS
+};
+
+/* The modules whose allocations are counted in FT_stats. */
+enum FT_subsystem { FT_SUB_FT, FT_SUB_NODE, FT_SUB_DYNARRAY,
+                    FT_SUB_ENGINE, FT_NUM_SUBSYSTEMS
+};
+
+/*
+   Operation counters for the FT and the modules beneath it, summed
+   over every thread that has used the FT. Every member is a size_t.
+*/
+struct FT_stats {
+   /* the number of calls to each FT entry point */
+   size_t calls[FT_NUM_OPS];
+   /* the number of paths resolved from the root, from a handle, or
+      from the last Node that the same thread resolved */
+   size_t lookups;
+   /* the number of those paths resolved from the last Node that the
+      same thread resolved */
+   size_t fingerHits;
+   /* the number of Nodes visited while resolving those paths */
+   size_t nodesVisited;
+   /* the number of comparisons of Nodes, or of a Node with a name,
+      made while ordering and looking up children */
+   size_t nodeCompares;
+   /* the number of searches for a child that a Bloom filter of the
+      children answered without searching them */
+   size_t filterRejects;
+   /* the number of elements probed by DynArray_bsearch */
+   size_t bsearchProbes;
+   /* the number of times a DynArray's physical length grew */
+   size_t dynArrayGrows;
+   /* the number of bytes shifted by DynArray_addAt/removeAt */
+   size_t memmovedBytes;
+   /* the number of calls to malloc/calloc by each subsystem */
+   size_t mallocs[FT_NUM_SUBSYSTEMS];
+   /* the number of calls to free by each subsystem */
+   size_t frees[FT_NUM_SUBSYSTEMS];
+};
+
 /*
    Inserts a new directory into the tree at path, if possible.
    Returns SUCCESS if the new directory is inserted,
@@ -102,6 +168,178 @@ void *FT_replaceFileContents(char *path, void *newContents,
  */
 int FT_stat(char *path, boolean* type, size_t* length);
 
+/*
+  The length-delimited forms of the calls above. Each takes its path
+  as the pathLength bytes at path, which must not include a '\0' but
+  need not be followed by one, so that a path may be a slice of a
+  larger buffer, and otherwise behaves as the call without the N. The
+  calls above are these with a pathLength of strlen(path).
+*/
+int FT_insertDirN(const char *path, size_t pathLength);
+boolean FT_containsDirN(const char *path, size_t pathLength);
+int FT_rmDirN(const char *path, size_t pathLength);
+int FT_insertFileN(const char *path, size_t pathLength,
+                   void *contents, size_t length);
+boolean FT_containsFileN(const char *path, size_t pathLength);
+int FT_rmFileN(const char *path, size_t pathLength);
+void *FT_getFileContentsN(const char *path, size_t pathLength);
+void *FT_replaceFileContentsN(const char *path, size_t pathLength,
+                              void *newContents, size_t newLength);
+int FT_statN(const char *path, size_t pathLength, boolean *type,
+             size_t *length);
+
+/*
+  Makes sure that the tree has a directory at path, inserting it and
+  any missing directories above it, as FT_insertDir does, if it is not
+  there already, in one descent from the root.
+  Returns SUCCESS if the directory is there when the call returns,
+  whether it was inserted or not,
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns CONFLICTING_PATH if path is not underneath existing root,
+  returns NOT_A_DIRECTORY if path or a path above it is a file,
+  returns PARENT_CHILD_ERROR if a new child cannot be added in path,
+  returns MEMORY_ERROR if unable to allocate sufficient memory.
+*/
+int FT_ensureDir(char *path);
+
+/*
+  Gives the file at path the contents contents of size length: the
+  file's contents are replaced, as FT_replaceFileContents does, if the
+  file exists, and otherwise the file is inserted, as FT_insertFile
+  does, all in one descent from the root. If pOldContents is not NULL,
+  stores the replaced contents in *pOldContents, or NULL if no
+  contents were replaced.
+  Returns SUCCESS if the file has the contents when the call returns,
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns CONFLICTING_PATH if path is not underneath existing root,
+  returns NOT_A_FILE if path is a directory,
+  returns NOT_A_DIRECTORY if a path above path is a file,
+  returns PARENT_CHILD_ERROR if a new child cannot be added in path,
+  returns MEMORY_ERROR if unable to allocate sufficient memory.
+*/
+int FT_upsertFile(char *path, void *contents, size_t length,
+                  void **pOldContents);
+
+/*
+  The length-delimited forms of FT_ensureDir and FT_upsertFile, as
+  for the calls above.
+*/
+int FT_ensureDirN(const char *path, size_t pathLength);
+int FT_upsertFileN(const char *path, size_t pathLength, void *contents,
+                   size_t length, void **pOldContents);
+
+/* What FT_statMany finds at one path. */
+struct FT_statResult {
+   /* SUCCESS if the path exists, and otherwise NO_SUCH_PATH */
+   int status;
+   /* TRUE if the path is a file, and FALSE if it is a directory */
+   boolean type;
+   /* the length of the file's contents, or 0 for a directory */
+   size_t length;
+};
+
+/*
+  Stats each of the n paths in paths, as FT_stat does, and stores what
+  it finds at paths[i] in results[i]. The paths are sorted and the
+  tree is walked once in that order, so each path resumes from the
+  deepest Node that it shares with the path before it rather than
+  descending from the root: a batch of paths in a few subtrees costs
+  little more than the Nodes it ends at.
+  Returns SUCCESS if every path was looked up, whether it exists or
+  not,
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns MEMORY_ERROR if unable to allocate memory to sort the paths.
+  When returning a non-SUCCESS status, results is unchanged.
+*/
+int FT_statMany(char *paths[], size_t n,
+                struct FT_statResult results[]);
+
+/*
+  Stats each of the n paths in paths, as FT_statMany does, but in the
+  order given, for batches of paths that share too little to be worth
+  sorting. Many lookups are kept in flight at once, advancing in turn
+  a level at a time, and each one prefetches what its next level reads
+  before making way for the others, so that their cache misses
+  overlap rather than wait in line. Allocates no memory.
+  Returns SUCCESS if every path was looked up, whether it exists or
+  not,
+  returns INITIALIZATION_ERROR if not in an initialized state, in which
+  case results is unchanged.
+*/
+int FT_statBatch(char *paths[], size_t n,
+                 struct FT_statResult results[]);
+
+/* A handle to a directory or file, which FT_open gives out: a slot of
+   a table that refers to the Node, and the generation of that slot
+   when the handle was given out. The Node can be reached through the
+   handle without walking its path until it is removed or the handle
+   is closed; from then on the handle is stale, even once the slot
+   holds another Node. */
+struct FT_handle {
+   unsigned int slot;
+   unsigned int generation;
+};
+
+/*
+  Stores in *pHandle a handle to the directory or file at path. A Node
+  has one handle at a time, so opening it again gives the same handle.
+  Returns SUCCESS if a handle is stored,
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if no such directory or file exists,
+  returns MEMORY_ERROR if unable to allocate memory for the handle, or
+  every handle is taken.
+  When returning a non-SUCCESS status, *pHandle is unchanged.
+*/
+int FT_open(char *path, struct FT_handle *pHandle);
+
+/*
+  Closes handle, so that it and every copy of it become stale.
+  Returns SUCCESS if handle was closed,
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if handle is already stale.
+*/
+int FT_close(struct FT_handle handle);
+
+/*
+  Inserts a file, as FT_insertFile does, at name, a path relative to
+  the directory that dir refers to: the path of that directory, a '/',
+  and name. Only the part of the path below the directory is walked.
+  Returns NO_SUCH_PATH if dir is stale, NOT_A_DIRECTORY if it refers
+  to a file, and otherwise what FT_insertFile returns for that path.
+*/
+int FT_insertFileAt(struct FT_handle dir, char *name, void *contents,
+                    size_t length);
+
+/*
+  Stats name, a path relative to the directory that dir refers to, as
+  FT_insertFileAt does, and as FT_stat does; "" names the directory
+  itself. Returns NO_SUCH_PATH if dir is stale, and otherwise what
+  FT_stat returns for that path.
+*/
+int FT_statAt(struct FT_handle dir, char *name, boolean *type,
+              size_t *length);
+
+/*
+  Returns the contents of the file that file refers to, or NULL if the
+  FT is not initialized, file is stale, or it refers to a directory.
+  Walks no path.
+*/
+void *FT_getFileContentsById(struct FT_handle file);
+
+/*
+  Stores in *pList a string of the names of the children of the
+  directory that dir refers to, each followed by a newline: its files
+  in order of name, then its subdirectories in order of name. The
+  caller owns the string and must free it.
+  Returns SUCCESS if the list is stored,
+  returns INITIALIZATION_ERROR if not in an initialized state,
+  returns NO_SUCH_PATH if dir is stale,
+  returns NOT_A_DIRECTORY if dir refers to a file,
+  returns MEMORY_ERROR if unable to allocate memory for the list.
+  When returning a non-SUCCESS status, *pList is unchanged.
+*/
+int FT_listAt(struct FT_handle dir, char **pList);
+
 /*
   Sets the data structure to initialized status.
   The data structure is initially empty.
@@ -128,4 +366,131 @@ int FT_destroy(void);
 */
 char *FT_toString();
 
+/*
+   The heap memory held by the FT, broken down by the structure that
+   holds it, as reported by FT_memoryReport. Every member is a size_t.
+*/
+struct FT_memory {
+   /* the number of Nodes in the hierarchy */
+   size_t nodes;
+   /* the bytes of the Node structures themselves */
+   size_t nodeBytes;
+   /* the bytes of the Nodes' path strings */
+   size_t pathBytes;
+   /* the bytes of the headers and chunk directories of the
+      directories' children (see children.h) */
+   size_t childHeaderBytes;
+   /* the bytes of child pointers in use in the directories' arrays */
+   size_t childArrayBytes;
+   /* the bytes allocated but not yet used in those arrays */
+   size_t childArraySlackBytes;
+   /* the bytes of the engine's indexes of the directories' children */
+   size_t indexBytes;
+   /* the bytes of the Bloom filters of large directories' children
+      (see children.h) */
+   size_t filterBytes;
+   /* the bytes of file contents, as given by their lengths; these are
+      owned by the client and are not included in totalBytes */
+   size_t contentBytes;
+   /* the number of heap blocks that make up the above */
+   size_t allocations;
+   /* the sum of every byte count above except contentBytes */
+   size_t totalBytes;
+   /* totalBytes / nodes, or 0 if the hierarchy is empty */
+   size_t bytesPerNode;
+};
+
+/*
+  Stores in *pStats the operation counters accumulated since the
+  program started or since the last call to FT_resetStats. Counters
+  are kept per thread and summed here, so this is cheap to count but
+  comparatively expensive to read.
+
+  If the FT was built with -DNSTATS, every counter reads as 0.
+*/
+void FT_getStats(struct FT_stats *pStats);
+
+/*
+  Sets every counter reported by FT_getStats, and every latency
+  reported by FT_getLatency and FT_dumpLatency, back to 0. A thread
+  that is in an FT call while another resets may add what it counts
+  to the values from before the reset, so the reset is exact only
+  when no other thread is calling the FT.
+*/
+void FT_resetStats(void);
+
+/*
+  Returns the latency, in ns, that the fraction quantile (between 0
+  and 1) of the calls to FT entry point op took at most, e.g. the p99
+  latency of FT_stat for op FT_OP_STAT and quantile 0.99. Latencies are
+  kept in log-scaled buckets, so the result is rounded up by at most
+  about 6%. Returns 0 if op has not been called.
+*/
+size_t FT_getLatency(enum FT_op op, double quantile);
+
+/*
+  Writes the call count and the mean, p50, p90, p99, p99.9 and maximum
+  latency of each FT entry point that has been called to stream: as
+  one line of text per entry point, or, if asJSON is TRUE, as a JSON
+  object keyed by entry point name that also lists every non-empty
+  histogram bucket as [upper bound in ns, count].
+*/
+void FT_dumpLatency(FILE *stream, boolean asJSON);
+
+/*
+  Stores in *pMemory a breakdown of the heap memory that the hierarchy
+  occupies, by structure.
+  Returns INITIALIZATION_ERROR if not in an initialized state,
+  MEMORY_ERROR if there is not enough memory to walk the hierarchy,
+  and SUCCESS otherwise.
+*/
+int FT_memoryReport(struct FT_memory *pMemory);
+
+/*
+  Checks every invariant of the hierarchy with the checker module: the
+  links between parents and children, the order of every directory's
+  children, and the count of Nodes. Hierarchies of more than a few
+  thousand Nodes are checked by a pool of threads, so no other call may
+  run while this one does. Meant for after loading a snapshot, such as
+  a manifest, or in tests; it walks the whole tree.
+  Returns TRUE if the hierarchy, initialized or not, is valid, and
+  FALSE (after writing the first problem found to stderr) otherwise.
+*/
+boolean FT_validate(void);
+
+/*
+  Makes the engine named name the one that finds children by name in
+  every directory of the hierarchy built after the next FT_init. The
+  engines are "sorted" (the default), "hash" and "trie"; see engine.h.
+  Returns SUCCESS if the engine is set,
+  returns INITIALIZATION_ERROR if in an initialized state, and
+  returns NO_SUCH_PATH if there is no engine named name.
+*/
+int FT_setEngine(const char *name);
+
+/*
+  Returns the name of the engine with identifier engineID (from 0),
+  for use with FT_setEngine, or NULL if there are not that many
+  engines.
+*/
+const char *FT_getEngineName(size_t engineID);
+
+/*
+  Starts recording every call to an FT entry point, with its path,
+  content length, result and timing (but not file contents), to the
+  binary trace stream, which must be open for writing and remains
+  owned by the caller; ft_replay replays such traces. See trace.h for
+  the format. Recording is off until this is called.
+  Returns SUCCESS if recording starts, and
+  returns INITIALIZATION_ERROR if calls are already being recorded.
+*/
+int FT_startTrace(FILE *stream);
+
+/*
+  Stops the recording started by FT_startTrace and flushes its stream.
+  Returns SUCCESS if recording stops, and
+  returns INITIALIZATION_ERROR if calls were not being recorded.
+*/
+int FT_stopTrace(void);
+
 #endif
@@ -0,0 +1,1243 @@
+/*--------------------------------------------------------------------*/
+/* ft_bench.c                                                         */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "ft.h"
+#include "manifest.h"
+#include "bench.h"
+
+/* The longest path any workload builds, including its '\0'. The
+   chain workload needs 5 bytes per level. */
+enum { MAX_PATH = 1 << 20 };
+
+/* The most engines that one run can compare. */
+enum { MAX_ENGINES = 16 };
+
+/* The number of lookups that each stress workload times. */
+enum { STRESS_LOOKUPS = 1000 };
+
+/* The number of paths that each FT_statMany call of the statmany
+   workload looks up. */
+enum { STAT_BATCH = 4096 };
+
+/* The number of files in the prefix stress workload. */
+enum { PREFIX_FILES = 10000 };
+
+/* The most threads the threads workload runs at once, which is also
+   the most shards it splits the tree into. */
+enum { MAX_THREADS = 256 };
+
+/* The workload parameters, as given on the command line. */
+struct benchConfig {
+   /* the number of operations in the random and flat workloads */
+   size_t ops;
+   /* the number of levels in the chain workload */
+   size_t chain;
+   /* the deepest directory the random workloads create */
+   size_t depth;
+   /* the number of distinct names per directory in the random and
+      dump workloads */
+   size_t fanout;
+   /* the number of toString calls in the dump workload */
+   size_t dumps;
+   /* the percentages of mkdir -p, insertFile, stat and rm operations
+      in the random workload; they sum to 100 */
+   size_t mix[4];
+   /* the seed of the pseudo-random number generator */
+   unsigned long seed;
+   /* the percentage of stat operations in the threads workload; the
+      rest are insertFile and rmFile in equal parts */
+   size_t reads;
+   /* the most threads the threads workload scales up to */
+   size_t threads;
+   /* the sharing mode of the threads workload, a SHARE_ value, or
+      SHARE_MODES for every mode */
+   int share;
+   /* the file the manifest workload builds its tree from, and the
+      trace it then replays, or NULL for none */
+   const char *manifest;
+   const char *trace;
+   /* the depth of the deep stress workload's chain */
+   size_t levels;
+   /* the number of files in the flat stress workload's directory */
+   size_t flat;
+   /* the length of the prefix shared by the names of the prefix
+      stress workload */
+   size_t prefix;
+   /* the file that every FT call of the run is recorded to, as by
+      FT_startTrace, or NULL for none */
+   const char *record;
+};
+
+/* The operations of the random workload, indexing benchConfig.mix. */
+enum { MIX_MKDIR, MIX_INSERT_FILE, MIX_STAT, MIX_RM, MIX_KINDS };
+
+/* How the threads workload shares the tree: every operation takes one
+   tree-wide lock; every operation takes the lock of one of the
+   shards, the directories below the root, chosen at random; or each
+   thread works alone in its own shard and takes no lock at all. */
+enum { SHARE_SHARED, SHARE_SHARDED, SHARE_PRIVATE, SHARE_MODES };
+
+/* The names of the sharing modes, indexed by SHARE_ value. */
+static const char *shareNames[SHARE_MODES] = {
+   "shared", "sharded", "private"
+};
+
+/* One thread of the threads workload. */
+struct benchThread {
+   /* the workload parameters */
+   const struct benchConfig *cfg;
+   /* the sharing mode, a SHARE_ value */
+   int share;
+   /* this thread's number, which is its shard in private mode */
+   size_t id;
+   /* the number of shards */
+   size_t shards;
+   /* the latency of each of this thread's operations, in ns */
+   size_t *latencies;
+   /* a buffer for building this thread's paths */
+   char *path;
+   /* this thread's pseudo-random number generator state */
+   unsigned long rng;
+   /* the barrier that releases every thread at once */
+   pthread_barrier_t *start;
+};
+
+/* The FT operations that manifest lines perform. */
+enum { REPLAY_INSERT_DIR, REPLAY_INSERT_FILE, REPLAY_STAT,
+       REPLAY_RM_FILE, REPLAY_RM_DIR, REPLAY_KINDS };
+
+/* The names of the manifest operations, indexed by REPLAY_ value. */
+static const char *replayNames[REPLAY_KINDS] = {
+   "insertDir", "insertFile", "stat", "rmFile", "rmDir"
+};
+
+/* The tree-wide lock of shared mode. */
+static pthread_rwlock_t treeLock;
+
+/* The per-shard locks of sharded mode. */
+static pthread_rwlock_t shardLocks[MAX_THREADS];
+
+/* A buffer for building paths. */
+static char pathBuf[MAX_PATH];
+
+/*--------------------------------------------------------------------*/
+
+/* Writes to pathBuf a random directory path under root "r" of 1 to
+   depth levels, each named from fanout choices, and returns the
+   length of that path. */
+static size_t Bench_randomDirPath(size_t depth, size_t fanout) {
+   size_t levels = 1 + Bench_random() % depth;
+   size_t length;
+   size_t l;
+
+   length = (size_t) sprintf(pathBuf, "r");
+   for(l = 0; l < levels; l++)
+      length += (size_t) sprintf(pathBuf + length, "/d%04lu",
+                         (unsigned long) (Bench_random() % fanout));
+   return length;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Builds a single chain of cfg->chain directories one level at a
+   time, then stats the deepest directory cfg->chain times. */
+static void Bench_chain(const struct benchConfig *cfg) {
+   size_t *latencies = Bench_newSizes(cfg->chain);
+   size_t length;
+   size_t start;
+   size_t total;
+   size_t i;
+   boolean isFile;
+   size_t fileLength;
+
+   assert(cfg->chain * 5 < MAX_PATH);
+
+   (void) FT_init();
+
+   length = (size_t) sprintf(pathBuf, "c");
+   total = Bench_startPhase();
+   for(i = 0; i < cfg->chain; i++) {
+      length += (size_t) sprintf(pathBuf + length, "/c%03lu",
+                                 (unsigned long) (i % 1000));
+      start = Bench_now();
+      (void) FT_insertDir(pathBuf);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("chain/insertDir", latencies, cfg->chain,
+                Bench_now() - total);
+
+   total = Bench_startPhase();
+   for(i = 0; i < cfg->chain; i++) {
+      start = Bench_now();
+      (void) FT_stat(pathBuf, &isFile, &fileLength);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("chain/stat", latencies, cfg->chain,
+                Bench_now() - total);
+
+   (void) FT_destroy();
+   free(latencies);
+}
+
+/* Inserts cfg->ops files in random order into one directory, then
+   looks each of them up, again in random order. */
+static void Bench_wide(const struct benchConfig *cfg) {
+   size_t *latencies = Bench_newSizes(cfg->ops);
+   size_t *order = Bench_newSizes(cfg->ops);
+   size_t start;
+   size_t total;
+   size_t i;
+   size_t j;
+   size_t swap;
+
+   Bench_seed(cfg->seed);
+   (void) FT_init();
+   (void) FT_insertDir("w");
+
+   for(i = 0; i < cfg->ops; i++)
+      order[i] = i;
+   for(i = cfg->ops; i > 1; i--) {
+      j = Bench_random() % i;
+      swap = order[i - 1];
+      order[i - 1] = order[j];
+      order[j] = swap;
+   }
+
+   total = Bench_startPhase();
+   for(i = 0; i < cfg->ops; i++) {
+      (void) sprintf(pathBuf, "w/f%010lu", (unsigned long) order[i]);
+      start = Bench_now();
+      (void) FT_insertFile(pathBuf, NULL, 0);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("wide/insertFile", latencies, cfg->ops,
+                Bench_now() - total);
+
+   total = Bench_startPhase();
+   for(i = 0; i < cfg->ops; i++) {
+      (void) sprintf(pathBuf, "w/f%010lu",
+                     (unsigned long) (Bench_random() % cfg->ops));
+      start = Bench_now();
+      (void) FT_containsFile(pathBuf);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("wide/containsFile", latencies, cfg->ops,
+                Bench_now() - total);
+
+   (void) FT_destroy();
+   free(order);
+   free(latencies);
+}
+
+/* Runs cfg->ops random mkdir -p, insertFile, stat and rm operations,
+   in the proportions cfg->mix, over paths of up to cfg->depth
+   directories with cfg->fanout names per level. */
+static void Bench_mix(const struct benchConfig *cfg) {
+   static const char *names[MIX_KINDS] = {
+      "mix/mkdir", "mix/insertFile", "mix/stat", "mix/rm"
+   };
+   size_t *latencies[MIX_KINDS];
+   size_t counts[MIX_KINDS] = { 0, 0, 0, 0 };
+   size_t totals[MIX_KINDS] = { 0, 0, 0, 0 };
+   size_t length;
+   size_t start;
+   size_t elapsed;
+   size_t roll;
+   size_t i;
+   int kind;
+   boolean isFile;
+   size_t fileLength;
+
+   for(kind = 0; kind < MIX_KINDS; kind++)
+      latencies[kind] = Bench_newSizes(cfg->ops);
+
+   Bench_seed(cfg->seed);
+   (void) FT_init();
+   (void) FT_insertDir("r");
+
+   for(i = 0; i < cfg->ops; i++) {
+      roll = Bench_random() % 100;
+      for(kind = 0; kind < MIX_KINDS - 1; kind++) {
+         if(roll < cfg->mix[kind])
+            break;
+         roll -= cfg->mix[kind];
+      }
+
+      length = Bench_randomDirPath(cfg->depth, cfg->fanout);
+      /* Half of the stats and removals are of files. */
+      if(kind == MIX_INSERT_FILE ||
+         ((kind == MIX_STAT || kind == MIX_RM) && Bench_random() % 2))
+         (void) sprintf(pathBuf + length, "/f%04lu",
+                        (unsigned long) (Bench_random() % cfg->fanout));
+
+      start = Bench_now();
+      switch(kind) {
+         case MIX_MKDIR:
+            (void) FT_insertDir(pathBuf);
+            break;
+         case MIX_INSERT_FILE:
+            (void) FT_insertFile(pathBuf, NULL, 0);
+            break;
+         case MIX_STAT:
+            (void) FT_stat(pathBuf, &isFile, &fileLength);
+            break;
+         default:
+            if(FT_rmFile(pathBuf) == NOT_A_FILE)
+               (void) FT_rmDir(pathBuf);
+            break;
+      }
+      elapsed = Bench_now() - start;
+      latencies[kind][counts[kind]++] = elapsed;
+      totals[kind] += elapsed;
+   }
+
+   for(kind = 0; kind < MIX_KINDS; kind++) {
+      Bench_report(names[kind], latencies[kind], counts[kind],
+                   totals[kind]);
+      free(latencies[kind]);
+   }
+
+   (void) FT_destroy();
+}
+
+/* Writes cfg->ops files at random paths, so that many are written
+   more than once, on a new tree: with FT_upsertFile if isUpsert, and
+   otherwise as callers without it do, with FT_insertFile and then
+   FT_replaceFileContents if the file exists. Reports the latencies,
+   stored in latencies, under label, unless label is NULL. */
+static void Bench_writeFiles(const struct benchConfig *cfg,
+                             boolean isUpsert, size_t *latencies,
+                             const char *label) {
+   size_t length;
+   size_t start;
+   size_t total;
+   size_t i;
+
+   Bench_seed(cfg->seed);
+   (void) FT_init();
+   (void) FT_insertDir("r");
+
+   total = Bench_startPhase();
+   for(i = 0; i < cfg->ops; i++) {
+      length = Bench_randomDirPath(cfg->depth, cfg->fanout);
+      (void) sprintf(pathBuf + length, "/f%04lu",
+                     (unsigned long) (Bench_random() % cfg->fanout));
+      start = Bench_now();
+      if(isUpsert)
+         (void) FT_upsertFile(pathBuf, NULL, i, NULL);
+      else if(FT_insertFile(pathBuf, NULL, i) == ALREADY_IN_TREE)
+         (void) FT_replaceFileContents(pathBuf, NULL, i);
+      latencies[i] = Bench_now() - start;
+   }
+   if(label != NULL)
+      Bench_report(label, latencies, cfg->ops, Bench_now() - total);
+
+   (void) FT_destroy();
+}
+
+/* Writes cfg->ops files at the same random paths with and without
+   FT_upsertFile (see Bench_writeFiles), after an untimed pass, so that
+   neither timed pass has a fresh heap that the other lacks. */
+static void Bench_upsert(const struct benchConfig *cfg) {
+   size_t *latencies = Bench_newSizes(cfg->ops);
+
+   Bench_writeFiles(cfg, FALSE, latencies, NULL);
+   Bench_writeFiles(cfg, FALSE, latencies, "upsert/insertOrReplace");
+   Bench_writeFiles(cfg, TRUE, latencies, "upsert/upsertFile");
+   free(latencies);
+}
+
+/* Writes cfg->ops files at random paths, then stats cfg->ops more
+   random paths, drawn as the files' were so that many exist: first
+   one at a time with FT_stat, and then STAT_BATCH at a time with
+   FT_statMany and with FT_statBatch, whose time for a batch is spread
+   evenly over its paths so that every row is per path. */
+static void Bench_statMany(const struct benchConfig *cfg) {
+   size_t *latencies = Bench_newSizes(cfg->ops);
+   size_t stride = cfg->depth * 6 + 8;
+   char *text = malloc(cfg->ops * stride);
+   char **paths = malloc(cfg->ops * sizeof(char *));
+   struct FT_statResult *results =
+      malloc(STAT_BATCH * sizeof(struct FT_statResult));
+   boolean isFile;
+   size_t fileLength;
+   size_t length;
+   size_t batch;
+   size_t start;
+   size_t total;
+   size_t i;
+   size_t j;
+   int isSorted;
+
+   if(text == NULL || paths == NULL || results == NULL) {
+      fprintf(stderr, "ft_bench: out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   Bench_seed(cfg->seed);
+   (void) FT_init();
+   (void) FT_insertDir("r");
+   for(i = 0; i < 2 * cfg->ops; i++) {
+      length = Bench_randomDirPath(cfg->depth, cfg->fanout);
+      (void) sprintf(pathBuf + length, "/f%04lu",
+                     (unsigned long) (Bench_random() % cfg->fanout));
+      if(i < cfg->ops)
+         (void) FT_upsertFile(pathBuf, NULL, i, NULL);
+      else {
+         paths[i - cfg->ops] = text + (i - cfg->ops) * stride;
+         (void) strcpy(paths[i - cfg->ops], pathBuf);
+      }
+   }
+
+   total = Bench_startPhase();
+   for(i = 0; i < cfg->ops; i++) {
+      start = Bench_now();
+      (void) FT_stat(paths[i], &isFile, &fileLength);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("statmany/stat", latencies, cfg->ops,
+                Bench_now() - total);
+
+   for(isSorted = 1; isSorted >= 0; isSorted--) {
+      total = Bench_startPhase();
+      for(i = 0; i < cfg->ops; i += batch) {
+         batch = cfg->ops - i < STAT_BATCH ? cfg->ops - i : STAT_BATCH;
+         start = Bench_now();
+         if(isSorted)
+            (void) FT_statMany(paths + i, batch, results);
+         else
+            (void) FT_statBatch(paths + i, batch, results);
+         start = Bench_now() - start;
+         for(j = 0; j < batch; j++)
+            latencies[i + j] = start / batch;
+      }
+      Bench_report(isSorted ? "statmany/statMany"
+                            : "statmany/statBatch",
+                   latencies, cfg->ops, Bench_now() - total);
+   }
+
+   (void) FT_destroy();
+   free(results);
+   free(paths);
+   free(text);
+   free(latencies);
+}
+
+/* Fills one directory, cfg->depth levels down, with cfg->ops files
+   and then stats each of them: first by whole path, with FT_insertFile
+   and FT_stat, and then, in a fresh tree, by name relative to a handle
+   to the directory, with FT_insertFileAt and FT_statAt. */
+static void Bench_handles(const struct benchConfig *cfg) {
+   size_t *latencies = Bench_newSizes(cfg->ops);
+   struct FT_handle dir;
+   char name[24];
+   size_t dirLength;
+   size_t start;
+   size_t total;
+   size_t i;
+   boolean isFile;
+   size_t fileLength;
+   int isRelative;
+
+   dirLength = (size_t) sprintf(pathBuf, "r");
+   for(i = 0; i < cfg->depth; i++)
+      dirLength += (size_t) sprintf(pathBuf + dirLength, "/d%04lu",
+                                    (unsigned long) i);
+
+   for(isRelative = 0; isRelative <= 1; isRelative++) {
+      (void) FT_init();
+      (void) FT_ensureDir(pathBuf);
+      (void) FT_open(pathBuf, &dir);
+
+      total = Bench_startPhase();
+      for(i = 0; i < cfg->ops; i++) {
+         (void) sprintf(name, "f%07lu", (unsigned long) i);
+         (void) sprintf(pathBuf + dirLength, "/%s", name);
+         start = Bench_now();
+         if(isRelative)
+            (void) FT_insertFileAt(dir, name, NULL, i);
+         else
+            (void) FT_insertFile(pathBuf, NULL, i);
+         latencies[i] = Bench_now() - start;
+      }
+      Bench_report(isRelative ? "handles/insertAt"
+                              : "handles/insert",
+                   latencies, cfg->ops, Bench_now() - total);
+
+      total = Bench_startPhase();
+      for(i = 0; i < cfg->ops; i++) {
+         (void) sprintf(name, "f%07lu", (unsigned long) i);
+         (void) sprintf(pathBuf + dirLength, "/%s", name);
+         start = Bench_now();
+         if(isRelative)
+            (void) FT_statAt(dir, name, &isFile, &fileLength);
+         else
+            (void) FT_stat(pathBuf, &isFile, &fileLength);
+         latencies[i] = Bench_now() - start;
+      }
+      Bench_report(isRelative ? "handles/statAt" : "handles/stat",
+                   latencies, cfg->ops, Bench_now() - total);
+
+      pathBuf[dirLength] = '\0';
+      (void) FT_destroy();
+   }
+
+   free(latencies);
+}
+
+/* Builds a tree of cfg->ops random directories and files, then
+   times cfg->dumps calls to FT_toString and, separately, the
+   FT_destroy that tears the tree down. */
+static void Bench_dump(const struct benchConfig *cfg) {
+   size_t *latencies = Bench_newSizes(cfg->dumps);
+   size_t length;
+   size_t start;
+   size_t total;
+   size_t i;
+   char *dump;
+
+   Bench_seed(cfg->seed);
+   (void) FT_init();
+   (void) FT_insertDir("r");
+   for(i = 0; i < cfg->ops; i++) {
+      length = Bench_randomDirPath(cfg->depth, cfg->fanout);
+      if(i % 2)
+         (void) sprintf(pathBuf + length, "/f%04lu", (unsigned long) i);
+      if(i % 2)
+         (void) FT_insertFile(pathBuf, NULL, 0);
+      else
+         (void) FT_insertDir(pathBuf);
+   }
+
+   total = Bench_startPhase();
+   for(i = 0; i < cfg->dumps; i++) {
+      start = Bench_now();
+      dump = FT_toString();
+      latencies[i] = Bench_now() - start;
+      free(dump);
+   }
+   Bench_report("dump/toString", latencies, cfg->dumps,
+                Bench_now() - total);
+
+   start = Bench_startPhase();
+   (void) FT_destroy();
+   latencies[0] = Bench_now() - start;
+   Bench_report("teardown/destroy", latencies, 1, latencies[0]);
+
+   free(latencies);
+}
+
+/* Writes to path a random path in shard shard of the threads
+   workload, of 1 to cfg->depth directories below the shard, ending in
+   a file name if isFile is TRUE, using the generator state *pRng. */
+static void Bench_shardPath(char *path, size_t shard, boolean isFile,
+                            const struct benchConfig *cfg,
+                            unsigned long *pRng) {
+   size_t levels = 1 + Bench_randomFrom(pRng) % cfg->depth;
+   size_t length;
+   size_t l;
+
+   length = (size_t) sprintf(path, "r/s%04lu", (unsigned long) shard);
+   for(l = 0; l < levels; l++)
+      length += (size_t) sprintf(path + length, "/d%04lu",
+                    (unsigned long) (Bench_randomFrom(pRng) % cfg->fanout));
+   if(isFile)
+      (void) sprintf(path + length, "/f%04lu",
+                     (unsigned long) (Bench_randomFrom(pRng) % cfg->fanout));
+}
+
+/* Waits for the start barrier, then runs cfg->ops random stat,
+   insertFile and rmFile operations as the struct benchThread that
+   pvThread points to, recording the latency of each, including the
+   time spent waiting for a lock. Returns NULL. */
+static void *Bench_threadRun(void *pvThread) {
+   struct benchThread *thread = pvThread;
+   const struct benchConfig *cfg = thread->cfg;
+   pthread_rwlock_t *lock;
+   size_t shard;
+   size_t start;
+   size_t i;
+   boolean isRead;
+   boolean isFile;
+   size_t fileLength;
+
+   (void) pthread_barrier_wait(thread->start);
+
+   for(i = 0; i < cfg->ops; i++) {
+      isRead = Bench_randomFrom(&thread->rng) % 100 < cfg->reads;
+      if(thread->share == SHARE_PRIVATE)
+         shard = thread->id;
+      else
+         shard = Bench_randomFrom(&thread->rng) % thread->shards;
+      /* Half of the stats are of directories. */
+      Bench_shardPath(thread->path, shard,
+                      !isRead || Bench_randomFrom(&thread->rng) % 2,
+                      cfg, &thread->rng);
+
+      if(thread->share == SHARE_SHARED)
+         lock = &treeLock;
+      else if(thread->share == SHARE_SHARDED)
+         lock = &shardLocks[shard];
+      else
+         lock = NULL;
+
+      start = Bench_now();
+      /* A stat only reads the tree, so ft.h lets stats overlap. */
+      if(lock != NULL) {
+         if(isRead)
+            (void) pthread_rwlock_rdlock(lock);
+         else
+            (void) pthread_rwlock_wrlock(lock);
+      }
+      if(isRead)
+         (void) FT_stat(thread->path, &isFile, &fileLength);
+      else if(Bench_randomFrom(&thread->rng) % 2)
+         (void) FT_insertFile(thread->path, NULL, 0);
+      else
+         (void) FT_rmFile(thread->path);
+      if(lock != NULL)
+         (void) pthread_rwlock_unlock(lock);
+      thread->latencies[i] = Bench_now() - start;
+   }
+
+   return NULL;
+}
+
+/* Builds a tree with cfg->threads shards of cfg->fanout squared
+   random files each, runs numThreads threads against it in sharing
+   mode share, and reports their combined throughput and latency. */
+static void Bench_threadsAt(const struct benchConfig *cfg, int share,
+                            size_t numThreads) {
+   struct benchThread threads[MAX_THREADS];
+   pthread_t ids[MAX_THREADS];
+   pthread_barrier_t start;
+   unsigned long rng;
+   size_t *latencies;
+   size_t begin;
+   size_t total;
+   size_t shard;
+   size_t started;
+   size_t t;
+   size_t i;
+   char name[32];
+
+   assert(numThreads > 0 && numThreads <= cfg->threads);
+
+   Bench_seedState(&rng, cfg->seed);
+   (void) FT_init();
+   (void) FT_insertDir("r");
+   for(shard = 0; shard < cfg->threads; shard++) {
+      (void) pthread_rwlock_init(&shardLocks[shard], NULL);
+      (void) sprintf(pathBuf, "r/s%04lu", (unsigned long) shard);
+      (void) FT_insertDir(pathBuf);
+      for(i = 0; i < cfg->fanout * cfg->fanout; i++) {
+         Bench_shardPath(pathBuf, shard, TRUE, cfg, &rng);
+         (void) FT_insertFile(pathBuf, NULL, 0);
+      }
+   }
+   (void) pthread_rwlock_init(&treeLock, NULL);
+   (void) pthread_barrier_init(&start, NULL, (unsigned) numThreads + 1);
+
+   for(t = 0; t < numThreads; t++) {
+      threads[t].cfg = cfg;
+      threads[t].share = share;
+      threads[t].id = t;
+      threads[t].shards = cfg->threads;
+      threads[t].latencies = Bench_newSizes(cfg->ops);
+      threads[t].path = malloc(cfg->depth * 6 + 24);
+      if(threads[t].path == NULL) {
+         fprintf(stderr, "ft_bench: out of memory\n");
+         exit(EXIT_FAILURE);
+      }
+      Bench_seedState(&threads[t].rng, cfg->seed + t + 1);
+      threads[t].start = &start;
+   }
+   for(started = 0; started < numThreads; started++)
+      if(pthread_create(&ids[started], NULL, Bench_threadRun,
+                        &threads[started]) != 0) {
+         fprintf(stderr, "ft_bench: cannot start thread %lu\n",
+                 (unsigned long) started);
+         exit(EXIT_FAILURE);
+      }
+
+   (void) pthread_barrier_wait(&start);
+   begin = Bench_now();
+   for(t = 0; t < numThreads; t++)
+      (void) pthread_join(ids[t], NULL);
+   total = Bench_now() - begin;
+
+   latencies = Bench_newSizes(numThreads * cfg->ops);
+   for(t = 0; t < numThreads; t++) {
+      memcpy(latencies + t * cfg->ops, threads[t].latencies,
+             cfg->ops * sizeof(size_t));
+      free(threads[t].latencies);
+      free(threads[t].path);
+   }
+   (void) sprintf(name, "%s/%lut", shareNames[share],
+                  (unsigned long) numThreads);
+   Bench_report(name, latencies, numThreads * cfg->ops, total);
+   free(latencies);
+
+   (void) pthread_barrier_destroy(&start);
+   (void) pthread_rwlock_destroy(&treeLock);
+   for(shard = 0; shard < cfg->threads; shard++)
+      (void) pthread_rwlock_destroy(&shardLocks[shard]);
+   (void) FT_destroy();
+}
+
+/* Runs the threads workload in each selected sharing mode at 1, 2,
+   4, ... threads up to cfg->threads, each thread running cfg->ops
+   operations, so that the throughput rows form a scaling curve. */
+static void Bench_threads(const struct benchConfig *cfg) {
+   int share;
+   size_t numThreads;
+
+   for(share = 0; share < SHARE_MODES; share++) {
+      if(cfg->share != SHARE_MODES && cfg->share != share)
+         continue;
+      numThreads = 1;
+      for(;;) {
+         Bench_threadsAt(cfg, share, numThreads);
+         if(numThreads == cfg->threads)
+            break;
+         numThreads *= 2;
+         if(numThreads > cfg->threads)
+            numThreads = cfg->threads;
+      }
+   }
+}
+
+/* Times FT_toString and then FT_destroy, once each, on the tree that
+   the stress workload named name built, and reports them as
+   name/toString and name/destroy. */
+static void Bench_stressFinish(const char *name) {
+   char label[32];
+   char *dump;
+   size_t latency;
+   size_t start;
+
+   start = Bench_startPhase();
+   dump = FT_toString();
+   latency = Bench_now() - start;
+   free(dump);
+   (void) sprintf(label, "%s/toString", name);
+   Bench_report(label, &latency, 1, latency);
+
+   start = Bench_startPhase();
+   (void) FT_destroy();
+   latency = Bench_now() - start;
+   (void) sprintf(label, "%s/destroy", name);
+   Bench_report(label, &latency, 1, latency);
+}
+
+/* Inserts a single chain of cfg->levels directories with one call,
+   stats directories at random depths in it, then dumps and destroys
+   it: the worst case for anything that recurses once per level. */
+static void Bench_deep(const struct benchConfig *cfg) {
+   size_t latencies[STRESS_LOOKUPS];
+   size_t length = 1;
+   size_t start;
+   size_t total;
+   size_t end;
+   size_t i;
+   char saved;
+   boolean isFile;
+   size_t fileLength;
+
+   assert(cfg->levels * 2 + 2 <= MAX_PATH);
+
+   Bench_seed(cfg->seed);
+   (void) FT_init();
+
+   pathBuf[0] = 'r';
+   for(i = 0; i < cfg->levels; i++) {
+      pathBuf[length++] = '/';
+      pathBuf[length++] = 'd';
+   }
+   pathBuf[length] = '\0';
+
+   start = Bench_startPhase();
+   (void) FT_insertDir(pathBuf);
+   latencies[0] = Bench_now() - start;
+   Bench_report("deep/insertDir", latencies, 1, latencies[0]);
+
+   total = Bench_startPhase();
+   for(i = 0; i < STRESS_LOOKUPS; i++) {
+      end = 1 + 2 * (Bench_random() % cfg->levels + 1);
+      saved = pathBuf[end];
+      pathBuf[end] = '\0';
+      start = Bench_now();
+      (void) FT_stat(pathBuf, &isFile, &fileLength);
+      latencies[i] = Bench_now() - start;
+      pathBuf[end] = saved;
+   }
+   Bench_report("deep/stat", latencies, STRESS_LOOKUPS,
+                Bench_now() - total);
+
+   Bench_stressFinish("deep");
+}
+
+/* Inserts cfg->flat files into one directory in name order, stats
+   random ones, then dumps and destroys the tree: the worst case for
+   anything that scans or copies a directory's children. */
+static void Bench_flat(const struct benchConfig *cfg) {
+   size_t *latencies = Bench_newSizes(cfg->flat);
+   size_t start;
+   size_t total;
+   size_t i;
+   boolean isFile;
+   size_t fileLength;
+
+   Bench_seed(cfg->seed);
+   (void) FT_init();
+   (void) FT_insertDir("f");
+
+   total = Bench_startPhase();
+   for(i = 0; i < cfg->flat; i++) {
+      (void) sprintf(pathBuf, "f/f%010lu", (unsigned long) i);
+      start = Bench_now();
+      (void) FT_insertFile(pathBuf, NULL, 0);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("flat/insertFile", latencies, cfg->flat,
+                Bench_now() - total);
+
+   total = Bench_startPhase();
+   for(i = 0; i < STRESS_LOOKUPS; i++) {
+      (void) sprintf(pathBuf, "f/f%010lu",
+                     (unsigned long) (Bench_random() % cfg->flat));
+      start = Bench_now();
+      (void) FT_stat(pathBuf, &isFile, &fileLength);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("flat/stat", latencies, STRESS_LOOKUPS,
+                Bench_now() - total);
+
+   Bench_stressFinish("flat");
+   free(latencies);
+}
+
+/* Inserts PREFIX_FILES files, whose names share their first
+   cfg->prefix bytes, into one directory in random order, stats random
+   ones, then dumps and destroys the tree: the worst case for anything
+   that compares or hashes whole names. */
+static void Bench_prefix(const struct benchConfig *cfg) {
+   size_t latencies[PREFIX_FILES];
+   size_t start;
+   size_t total;
+   size_t i;
+   boolean isFile;
+   size_t fileLength;
+
+   assert(cfg->prefix + 16 <= MAX_PATH);
+
+   Bench_seed(cfg->seed);
+   (void) FT_init();
+   (void) FT_insertDir("p");
+
+   (void) strcpy(pathBuf, "p/");
+   memset(pathBuf + 2, 'x', cfg->prefix);
+
+   total = Bench_startPhase();
+   for(i = 0; i < PREFIX_FILES; i++) {
+      (void) sprintf(pathBuf + 2 + cfg->prefix, "%08lu",
+                     (unsigned long) (i * 7919 % PREFIX_FILES));
+      start = Bench_now();
+      (void) FT_insertFile(pathBuf, NULL, 0);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("prefix/insertFile", latencies, PREFIX_FILES,
+                Bench_now() - total);
+
+   total = Bench_startPhase();
+   for(i = 0; i < STRESS_LOOKUPS; i++) {
+      (void) sprintf(pathBuf + 2 + cfg->prefix, "%08lu",
+                     (unsigned long) (Bench_random() % PREFIX_FILES));
+      start = Bench_now();
+      (void) FT_stat(pathBuf, &isFile, &fileLength);
+      latencies[i] = Bench_now() - start;
+   }
+   Bench_report("prefix/stat", latencies, STRESS_LOOKUPS,
+                Bench_now() - total);
+
+   Bench_stressFinish("prefix");
+}
+
+/* Returns the FT operation, a REPLAY_ value, that a manifest line of
+   kind kind performs. */
+static int Bench_replayKind(enum Manifest_kind kind) {
+   switch(kind) {
+      case MANIFEST_DIR:
+      case MANIFEST_INSERT_DIR:
+         return REPLAY_INSERT_DIR;
+      case MANIFEST_FILE:
+      case MANIFEST_INSERT_FILE:
+         return REPLAY_INSERT_FILE;
+      case MANIFEST_STAT:
+         return REPLAY_STAT;
+      case MANIFEST_RM_FILE:
+         return REPLAY_RM_FILE;
+      default:
+         return REPLAY_RM_DIR;
+   }
+}
+
+/* Performs every line of manifest on the FT in order, and reports the
+   throughput and latency of each kind of FT operation under the name
+   prefix/operation. Warns on stderr if any operation fails. */
+static void Bench_replay(Manifest_T manifest, const char *prefix) {
+   size_t *latencies[REPLAY_KINDS];
+   size_t counts[REPLAY_KINDS] = { 0, 0, 0, 0, 0 };
+   size_t totals[REPLAY_KINDS] = { 0, 0, 0, 0, 0 };
+   const struct Manifest_entry *entry;
+   size_t failures = 0;
+   size_t elapsed;
+   size_t start;
+   size_t i;
+   int kind;
+   int result;
+   boolean isFile;
+   size_t fileLength;
+   char name[64];
+
+   assert(manifest != NULL);
+   assert(prefix != NULL);
+
+   for(i = 0; i < Manifest_getLength(manifest); i++)
+      counts[Bench_replayKind(Manifest_get(manifest, i)->kind)]++;
+   for(kind = 0; kind < REPLAY_KINDS; kind++) {
+      latencies[kind] = Bench_newSizes(counts[kind] + 1);
+      counts[kind] = 0;
+   }
+
+   for(i = 0; i < Manifest_getLength(manifest); i++) {
+      entry = Manifest_get(manifest, i);
+      kind = Bench_replayKind(entry->kind);
+      start = Bench_now();
+      switch(kind) {
+         case REPLAY_INSERT_DIR:
+            result = FT_insertDir(entry->path);
+            break;
+         case REPLAY_INSERT_FILE:
+            result = FT_insertFile(entry->path, NULL, entry->length);
+            break;
+         case REPLAY_STAT:
+            result = FT_stat(entry->path, &isFile, &fileLength);
+            break;
+         case REPLAY_RM_FILE:
+            result = FT_rmFile(entry->path);
+            break;
+         default:
+            result = FT_rmDir(entry->path);
+            break;
+      }
+      elapsed = Bench_now() - start;
+      latencies[kind][counts[kind]++] = elapsed;
+      totals[kind] += elapsed;
+      if(result != SUCCESS)
+         failures++;
+   }
+
+   for(kind = 0; kind < REPLAY_KINDS; kind++) {
+      (void) sprintf(name, "%s/%s", prefix, replayNames[kind]);
+      Bench_report(name, latencies[kind], counts[kind], totals[kind]);
+      free(latencies[kind]);
+   }
+   if(failures != 0)
+      fprintf(stderr, "ft_bench: %lu %s operations failed\n",
+              (unsigned long) failures, prefix);
+}
+
+/* Builds the hierarchy listed in the manifest file cfg->manifest (see
+   manifest.h), such as one that ft_gen writes, timing each insertion,
+   checks it with FT_validate, and then replays the operation trace in
+   cfg->trace on it, if there is one. Exits if either file cannot be
+   loaded or the hierarchy is not valid. */
+static void Bench_manifest(const struct benchConfig *cfg) {
+   Manifest_T manifest;
+   Manifest_T trace = NULL;
+
+   assert(cfg->manifest != NULL);
+
+   manifest = Manifest_load(cfg->manifest);
+   if(manifest == NULL)
+      exit(EXIT_FAILURE);
+   if(cfg->trace != NULL) {
+      trace = Manifest_load(cfg->trace);
+      if(trace == NULL)
+         exit(EXIT_FAILURE);
+   }
+
+   (void) FT_init();
+   Bench_replay(manifest, "load");
+   if(!FT_validate()) {
+      fprintf(stderr, "ft_bench: the tree loaded from %s is not valid\n",
+              cfg->manifest);
+      exit(EXIT_FAILURE);
+   }
+   if(trace != NULL)
+      Bench_replay(trace, "trace");
+   (void) FT_destroy();
+
+   if(trace != NULL)
+      Manifest_free(trace);
+   Manifest_free(manifest);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Prints how to invoke the program to stderr. */
+static void Bench_usage(const char *program) {
+   fprintf(stderr,
+      "usage: %s [-w workload] [-n ops] [-c chain] [-d depth]\n"
+      "          [-f fanout] [-k dumps] [-m mkdir,file,stat,rm]\n"
+      "          [-s seed] [-e engine[,engine...]] [-r reads%%]\n"
+      "          [-j threads] [-t shared|sharded|private|all]\n"
+      "          [-M manifest] [-T trace] [-R record]\n"
+      "          [-L levels] [-W files] [-P prefix] [-x runs] [-J] [-H]\n",
+      program);
+   fprintf(stderr,
+      "workloads: chain, wide, mix, upsert, statmany, handles, dump,\n"
+      "           all (default), and threads, manifest, and the stress\n"
+      "           workloads deep, flat and prefix, or stress for all\n"
+      "           three (not part of all)\n"
+      "engines: sorted (default), hash, trie, all\n");
+   fprintf(stderr,
+      "-x repeats every workload runs times; -J prints JSON for\n"
+      "ft_benchcmp instead of tables; -H also counts cycles,\n"
+      "instructions, and L1d, LLC and branch misses per op in the\n"
+      "phases that run one kind of operation, where the hardware\n"
+      "counters can be opened\n");
+}
+
+/* Parses the -m argument text into the four percentages of cfg->mix.
+   Returns TRUE if text is four non-negative integers that sum to
+   100, and FALSE otherwise. */
+static boolean Bench_parseMix(const char *text,
+                              struct benchConfig *cfg) {
+   unsigned long parts[MIX_KINDS];
+   int kind;
+   size_t sum = 0;
+
+   if(sscanf(text, "%lu,%lu,%lu,%lu", &parts[0], &parts[1],
+             &parts[2], &parts[3]) != MIX_KINDS)
+      return FALSE;
+   for(kind = 0; kind < MIX_KINDS; kind++) {
+      cfg->mix[kind] = parts[kind];
+      sum += parts[kind];
+   }
+   return sum == 100;
+}
+
+/* Splits the -e argument text, a comma-separated list of engine
+   names or "all", into names, storing the number of engines in
+   *pNumEngines. Returns TRUE if every engine exists, and FALSE
+   otherwise. */
+static boolean Bench_parseEngines(char *text, const char **names,
+                                  size_t *pNumEngines) {
+   char *name;
+
+   *pNumEngines = 0;
+   if(!strcmp(text, "all")) {
+      while(*pNumEngines < MAX_ENGINES &&
+            (names[*pNumEngines] = FT_getEngineName(*pNumEngines))
+               != NULL)
+         (*pNumEngines)++;
+      return TRUE;
+   }
+
+   for(name = strtok(text, ","); name != NULL;
+       name = strtok(NULL, ",")) {
+      if(*pNumEngines == MAX_ENGINES || FT_setEngine(name) != SUCCESS)
+         return FALSE;
+      names[(*pNumEngines)++] = name;
+   }
+   return *pNumEngines > 0;
+}
+
+/* Runs the workloads selected by workload with the parameters cfg,
+   on a tree that uses the engine named engine, as run run (from 0) of
+   runs. */
+static void Bench_runEngine(const char *engine, const char *workload,
+                            const struct benchConfig *cfg, size_t run,
+                            size_t runs) {
+   (void) FT_setEngine(engine);
+   Bench_beginGroup(engine, run, runs);
+
+   Bench_printHeader("workload");
+   if(!strcmp(workload, "chain") || !strcmp(workload, "all"))
+      Bench_chain(cfg);
+   if(!strcmp(workload, "wide") || !strcmp(workload, "all"))
+      Bench_wide(cfg);
+   if(!strcmp(workload, "mix") || !strcmp(workload, "all"))
+      Bench_mix(cfg);
+   if(!strcmp(workload, "upsert") || !strcmp(workload, "all"))
+      Bench_upsert(cfg);
+   if(!strcmp(workload, "statmany") || !strcmp(workload, "all"))
+      Bench_statMany(cfg);
+   if(!strcmp(workload, "handles") || !strcmp(workload, "all"))
+      Bench_handles(cfg);
+   if(!strcmp(workload, "dump") || !strcmp(workload, "all"))
+      Bench_dump(cfg);
+   if(!strcmp(workload, "threads"))
+      Bench_threads(cfg);
+   if(!strcmp(workload, "manifest"))
+      Bench_manifest(cfg);
+   if(!strcmp(workload, "deep") || !strcmp(workload, "stress"))
+      Bench_deep(cfg);
+   if(!strcmp(workload, "flat") || !strcmp(workload, "stress"))
+      Bench_flat(cfg);
+   if(!strcmp(workload, "prefix") || !strcmp(workload, "stress"))
+      Bench_prefix(cfg);
+}
+
+/* Runs the workloads selected on the command line (see Bench_usage)
+   once per selected engine, so that the engines are compared on
+   identical operations, and as many times over as asked, so that
+   ft_benchcmp can tell changes from noise. Prints their throughput and
+   latency percentiles, and with -H their hardware event counts, as
+   tables or JSON, followed by the peak resident set size of the
+   process. Returns 0, or 1 if the command line is invalid. */
+int main(int argc, char *argv[]) {
+   struct benchConfig cfg;
+   const char *workload = "all";
+   const char *engines[MAX_ENGINES];
+   size_t numEngines = 1;
+   size_t e;
+   size_t runs = 1;
+   size_t run;
+   boolean asJSON = FALSE;
+   boolean isCounted = FALSE;
+   struct rusage usage;
+   FILE *recording = NULL;
+   long online;
+   int option;
+
+   cfg.ops = 100000;
+   cfg.chain = 1000;
+   cfg.depth = 6;
+   cfg.fanout = 16;
+   cfg.dumps = 10;
+   cfg.mix[MIX_MKDIR] = 20;
+   cfg.mix[MIX_INSERT_FILE] = 20;
+   cfg.mix[MIX_STAT] = 50;
+   cfg.mix[MIX_RM] = 10;
+   cfg.seed = 217;
+   cfg.reads = 90;
+   online = sysconf(_SC_NPROCESSORS_ONLN);
+   cfg.threads = online < 1 ? 1 : (size_t) online;
+   if(cfg.threads > MAX_THREADS)
+      cfg.threads = MAX_THREADS;
+   cfg.share = SHARE_MODES;
+   cfg.manifest = NULL;
+   cfg.trace = NULL;
+   cfg.record = NULL;
+   cfg.levels = 10000;
+   cfg.flat = 1000000;
+   cfg.prefix = 4096;
+   engines[0] = FT_getEngineName(0);
+
+   while((option = getopt(argc, argv,
+             "w:n:c:d:f:k:m:s:e:r:j:t:M:T:R:L:W:P:x:JH")) != -1) {
+      switch(option) {
+         case 'w': workload = optarg; break;
+         case 'n': cfg.ops = strtoul(optarg, NULL, 10); break;
+         case 'c': cfg.chain = strtoul(optarg, NULL, 10); break;
+         case 'd': cfg.depth = strtoul(optarg, NULL, 10); break;
+         case 'f': cfg.fanout = strtoul(optarg, NULL, 10); break;
+         case 'k': cfg.dumps = strtoul(optarg, NULL, 10); break;
+         case 's': cfg.seed = strtoul(optarg, NULL, 10); break;
+         case 'r': cfg.reads = strtoul(optarg, NULL, 10); break;
+         case 'j': cfg.threads = strtoul(optarg, NULL, 10); break;
+         case 'M': cfg.manifest = optarg; break;
+         case 'T': cfg.trace = optarg; break;
+         case 'R': cfg.record = optarg; break;
+         case 'L': cfg.levels = strtoul(optarg, NULL, 10); break;
+         case 'W': cfg.flat = strtoul(optarg, NULL, 10); break;
+         case 'P': cfg.prefix = strtoul(optarg, NULL, 10); break;
+         case 'x': runs = strtoul(optarg, NULL, 10); break;
+         case 'J': asJSON = TRUE; break;
+         case 'H': isCounted = TRUE; break;
+         case 't':
+            for(cfg.share = 0; cfg.share < SHARE_MODES; cfg.share++)
+               if(!strcmp(optarg, shareNames[cfg.share]))
+                  break;
+            if(cfg.share == SHARE_MODES && strcmp(optarg, "all")) {
+               Bench_usage(argv[0]);
+               return 1;
+            }
+            break;
+         case 'e':
+            if(!Bench_parseEngines(optarg, engines, &numEngines)) {
+               Bench_usage(argv[0]);
+               return 1;
+            }
+            break;
+         case 'm':
+            if(!Bench_parseMix(optarg, &cfg)) {
+               Bench_usage(argv[0]);
+               return 1;
+            }
+            break;
+         default:
+            Bench_usage(argv[0]);
+            return 1;
+      }
+   }
+   if(optind != argc || cfg.depth == 0 || cfg.fanout == 0 ||
+      cfg.chain * 5 >= MAX_PATH || cfg.depth * 6 + 8 >= MAX_PATH ||
+      (strcmp(workload, "chain") && strcmp(workload, "wide") &&
+       strcmp(workload, "mix") && strcmp(workload, "upsert") &&
+       strcmp(workload, "statmany") && strcmp(workload, "handles") &&
+       strcmp(workload, "dump") &&
+       strcmp(workload, "threads") && strcmp(workload, "manifest") &&
+       strcmp(workload, "deep") && strcmp(workload, "flat") &&
+       strcmp(workload, "prefix") && strcmp(workload, "stress") &&
+       strcmp(workload, "all")) ||
+      cfg.levels == 0 || cfg.levels * 2 + 2 > MAX_PATH ||
+      cfg.flat == 0 || cfg.prefix + 16 > MAX_PATH || runs == 0 ||
+      (!strcmp(workload, "manifest") && cfg.manifest == NULL) ||
+      cfg.reads > 100 || cfg.threads == 0 || cfg.threads > MAX_THREADS) {
+      Bench_usage(argv[0]);
+      return 1;
+   }
+
+   if(cfg.record != NULL) {
+      recording = fopen(cfg.record, "wb");
+      if(recording == NULL) {
+         fprintf(stderr, "%s: cannot open\n", cfg.record);
+         return 1;
+      }
+      (void) FT_startTrace(recording);
+   }
+
+   if(isCounted)
+      (void) Bench_enableCounters();
+
+   Bench_beginReport(asJSON);
+   for(run = 0; run < runs; run++)
+      for(e = 0; e < numEngines; e++)
+         Bench_runEngine(engines[e], workload, &cfg, run, runs);
+
+   if(cfg.record != NULL) {
+      (void) FT_stopTrace();
+      (void) fclose(recording);
+   }
+
+   Bench_endReport(getrusage(RUSAGE_SELF, &usage) == 0 ?
+                   usage.ru_maxrss : -1);
+
+   return 0;
+}
@@ -0,0 +1,470 @@
+/*--------------------------------------------------------------------*/
+/* ft_benchcmp.c                                                      */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "a4def.h"
+#include "dynarray.h"
+
+/* The longest line of a report that can be read, and the longest
+   engine or workload name. */
+enum { MAX_LINE = 1024 };
+enum { MAX_FIELD = 64 };
+
+/* The most per-workload thresholds that one run can set. */
+enum { MAX_THRESHOLDS = 64 };
+
+/* The most iterations of the continued fraction for the incomplete
+   beta function, and the precision it stops at. */
+enum { MAX_ITERATIONS = 300 };
+#define EPSILON 1e-12
+
+/* One result row of an ft_bench JSON report. */
+struct row {
+   /* the engine and the workload phase that the row measures */
+   char engine[MAX_FIELD];
+   char name[MAX_FIELD];
+   /* the value of the metric being compared */
+   double value;
+};
+
+/* A regression threshold for the workloads whose name (or the part of
+   it before the '/') is name. */
+struct threshold {
+   const char *name;
+   double percent;
+};
+
+/* The summary of one group of rows: the runs of one engine and
+   workload phase in one report. */
+struct sample {
+   size_t n;
+   double mean;
+   double variance;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Copies the string value of member key in the JSON object on line
+   into value, which holds MAX_FIELD bytes. Returns TRUE, or FALSE if
+   there is no such member or the value is too long. */
+static boolean Cmp_getString(const char *line, const char *key,
+                             char *value) {
+   char pattern[MAX_FIELD + 8];
+   const char *start;
+   const char *end;
+
+   (void) sprintf(pattern, "\"%s\": \"", key);
+   start = strstr(line, pattern);
+   if(start == NULL)
+      return FALSE;
+   start += strlen(pattern);
+   end = strchr(start, '"');
+   if(end == NULL || end - start >= MAX_FIELD)
+      return FALSE;
+   memcpy(value, start, (size_t) (end - start));
+   value[end - start] = '\0';
+   return TRUE;
+}
+
+/* Stores the number value of member key in the JSON object on line in
+   *pValue. Returns TRUE, or FALSE if there is no such member. */
+static boolean Cmp_getNumber(const char *line, const char *key,
+                             double *pValue) {
+   char pattern[MAX_FIELD + 8];
+   const char *start;
+   char *end;
+
+   (void) sprintf(pattern, "\"%s\": ", key);
+   start = strstr(line, pattern);
+   if(start == NULL)
+      return FALSE;
+   start += strlen(pattern);
+   *pValue = strtod(start, &end);
+   return end != start;
+}
+
+/* Compares the rows that pv1 and pv2 point to by engine and then by
+   name, for DynArray_sort. */
+static int Cmp_compareRows(const void *pv1, const void *pv2) {
+   const struct row *row1 = pv1;
+   const struct row *row2 = pv2;
+   int result = strcmp(row1->engine, row2->engine);
+
+   if(result != 0)
+      return result;
+   return strcmp(row1->name, row2->name);
+}
+
+/* Frees every row in rows, and rows itself. */
+static void Cmp_freeRows(DynArray_T rows) {
+   size_t i;
+
+   for(i = 0; i < DynArray_getLength(rows); i++)
+      free(DynArray_get(rows, i));
+   DynArray_free(rows);
+}
+
+/* Reads the result rows of the ft_bench JSON report in the file named
+   filename that have the member metric, keeping its value, and
+   returns them in a new DynArray sorted by engine and name. Returns
+   NULL (after writing why to stderr) if the file cannot be read,
+   holds no such rows, or there is not enough memory. */
+static DynArray_T Cmp_load(const char *filename, const char *metric) {
+   DynArray_T rows;
+   struct row *row;
+   FILE *stream;
+   char line[MAX_LINE];
+
+   stream = fopen(filename, "r");
+   if(stream == NULL) {
+      fprintf(stderr, "%s: cannot open\n", filename);
+      return NULL;
+   }
+   rows = DynArray_new(0);
+   if(rows == NULL) {
+      (void) fclose(stream);
+      fprintf(stderr, "%s: out of memory\n", filename);
+      return NULL;
+   }
+
+   while(fgets(line, MAX_LINE, stream) != NULL) {
+      if(strstr(line, "\"name\": ") == NULL)
+         continue;
+      row = malloc(sizeof(struct row));
+      if(row == NULL || !DynArray_add(rows, row)) {
+         free(row);
+         Cmp_freeRows(rows);
+         (void) fclose(stream);
+         fprintf(stderr, "%s: out of memory\n", filename);
+         return NULL;
+      }
+      if(!Cmp_getString(line, "engine", row->engine) ||
+         !Cmp_getString(line, "name", row->name)) {
+         Cmp_freeRows(rows);
+         (void) fclose(stream);
+         fprintf(stderr, "%s: malformed row\n", filename);
+         return NULL;
+      }
+      /* only the phases that ft_bench -H counted have counter
+         members */
+      if(!Cmp_getNumber(line, metric, &row->value))
+         free(DynArray_removeAt(rows, DynArray_getLength(rows) - 1));
+   }
+   (void) fclose(stream);
+
+   if(DynArray_getLength(rows) == 0) {
+      Cmp_freeRows(rows);
+      fprintf(stderr, "%s: no results with %s; run ft_bench with -J "
+              "(and -H for counters)\n", filename, metric);
+      return NULL;
+   }
+   DynArray_sort(rows, Cmp_compareRows);
+   return rows;
+}
+
+/* Summarizes the rows of rows from index *pNext on that share the
+   engine and name of that first one into *pSample, and advances
+   *pNext past them. */
+static void Cmp_summarize(DynArray_T rows, size_t *pNext,
+                          struct sample *pSample) {
+   const struct row *first = DynArray_get(rows, *pNext);
+   const struct row *row;
+   double sum = 0.0;
+   double squares = 0.0;
+   size_t i;
+
+   for(i = *pNext; i < DynArray_getLength(rows); i++) {
+      row = DynArray_get(rows, i);
+      if(Cmp_compareRows(row, first) != 0)
+         break;
+      sum += row->value;
+   }
+   pSample->n = i - *pNext;
+   pSample->mean = sum / (double) pSample->n;
+
+   for(i = *pNext; i < *pNext + pSample->n; i++) {
+      row = DynArray_get(rows, i);
+      squares += (row->value - pSample->mean)
+         * (row->value - pSample->mean);
+   }
+   pSample->variance = pSample->n < 2 ? 0.0 :
+      squares / (double) (pSample->n - 1);
+   *pNext = i;
+}
+
+/* Returns the continued fraction of the regularized incomplete beta
+   function I_x(a, b), evaluated by the modified Lentz method. */
+static double Cmp_betaFraction(double a, double b, double x) {
+   double c = 1.0;
+   double d = 1.0 - (a + b) * x / (a + 1.0);
+   double result;
+   double delta;
+   double m2;
+   double step;
+   int m;
+
+   if(fabs(d) < 1e-300)
+      d = 1e-300;
+   d = 1.0 / d;
+   result = d;
+   for(m = 1; m <= MAX_ITERATIONS; m++) {
+      m2 = 2.0 * m;
+      step = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+      d = 1.0 + step * d;
+      c = 1.0 + step / c;
+      if(fabs(d) < 1e-300)
+         d = 1e-300;
+      if(fabs(c) < 1e-300)
+         c = 1e-300;
+      d = 1.0 / d;
+      result *= d * c;
+
+      step = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+      d = 1.0 + step * d;
+      c = 1.0 + step / c;
+      if(fabs(d) < 1e-300)
+         d = 1e-300;
+      if(fabs(c) < 1e-300)
+         c = 1e-300;
+      d = 1.0 / d;
+      delta = d * c;
+      result *= delta;
+      if(fabs(delta - 1.0) < EPSILON)
+         break;
+   }
+   return result;
+}
+
+/* Returns the regularized incomplete beta function I_x(a, b). */
+static double Cmp_incompleteBeta(double a, double b, double x) {
+   double front;
+
+   if(x <= 0.0)
+      return 0.0;
+   if(x >= 1.0)
+      return 1.0;
+
+   front = exp(lgamma(a + b) - lgamma(a) - lgamma(b)
+               + a * log(x) + b * log(1.0 - x));
+   if(x < (a + 1.0) / (a + b + 2.0))
+      return front * Cmp_betaFraction(a, b, x) / a;
+   return 1.0 - front * Cmp_betaFraction(b, a, 1.0 - x) / b;
+}
+
+/* Returns the two-sided p-value of Welch's t-test of the hypothesis
+   that the samples *pBase and *pCand, of at least two runs each, have
+   the same mean. */
+static double Cmp_welch(const struct sample *pBase,
+                        const struct sample *pCand) {
+   double v1 = pBase->variance / (double) pBase->n;
+   double v2 = pCand->variance / (double) pCand->n;
+   double t;
+   double df;
+
+   if(v1 + v2 == 0.0)
+      return pBase->mean == pCand->mean ? 1.0 : 0.0;
+
+   t = (pCand->mean - pBase->mean) / sqrt(v1 + v2);
+   df = (v1 + v2) * (v1 + v2)
+      / (v1 * v1 / (double) (pBase->n - 1)
+         + v2 * v2 / (double) (pCand->n - 1));
+   return Cmp_incompleteBeta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+/* Returns the regression threshold, in percent, for the workload phase
+   named name: the last of the numThresholds thresholds that names it
+   or its workload, or fallback if none does. */
+static double Cmp_thresholdFor(const char *name,
+                               const struct threshold *thresholds,
+                               size_t numThresholds, double fallback) {
+   size_t length;
+   size_t i;
+   double result = fallback;
+
+   for(i = 0; i < numThresholds; i++) {
+      length = strlen(thresholds[i].name);
+      if(!strcmp(name, thresholds[i].name) ||
+         (!strncmp(name, thresholds[i].name, length) &&
+          name[length] == '/'))
+         result = thresholds[i].percent;
+   }
+   return result;
+}
+
+/* Prints how to invoke the program to stderr. */
+static void Cmp_usage(const char *program) {
+   fprintf(stderr,
+      "usage: %s [-m metric] [-t [workload=]percent]... [-a alpha]\n"
+      "          baseline.json candidate.json\n"
+      "metrics: opsPerSec (default), p50, p90, p99, p999, max,\n"
+      "         cycles, instructions, l1dMisses, llcMisses,\n"
+      "         branchMisses (per op)\n"
+      "-t sets the regression threshold (default 10), for every\n"
+      "   workload or for one workload or phase, e.g. -t wide=5\n"
+      "-a sets the significance level of Welch's t-test (0.05)\n",
+      program);
+}
+
+/* Compares two ft_bench JSON reports (see Cmp_usage), each of one or
+   more runs of the same workloads, group by group: every engine and
+   workload phase in both. Prints the mean of the metric in each, the
+   change, the p-value of Welch's t-test where both have two or more
+   runs, and a verdict: REGRESSION if the candidate is worse by more
+   than the threshold and the change is significant (or cannot be
+   tested), improved if it is better by as much, noise if the change
+   is that large but not significant, and ok otherwise. Returns 0 if
+   nothing regressed, 1 if something did, and 2 if the command line is
+   invalid or a report cannot be read. */
+int main(int argc, char *argv[]) {
+   const char *metric = "opsPerSec";
+   struct threshold thresholds[MAX_THRESHOLDS];
+   size_t numThresholds = 0;
+   double fallback = 10.0;
+   double alpha = 0.05;
+   DynArray_T base;
+   DynArray_T cand;
+   size_t nextBase = 0;
+   size_t nextCand = 0;
+   struct sample baseSample;
+   struct sample candSample;
+   const struct row *baseRow;
+   const struct row *candRow;
+   boolean isHigherBetter;
+   boolean isSignificant;
+   double change;
+   double worse;
+   double p;
+   double limit;
+   const char *verdict;
+   size_t regressions = 0;
+   char *equals;
+   char pText[16];
+   int order;
+   int option;
+
+   while((option = getopt(argc, argv, "m:t:a:")) != -1) {
+      switch(option) {
+         case 'm': metric = optarg; break;
+         case 'a': alpha = strtod(optarg, NULL); break;
+         case 't':
+            equals = strchr(optarg, '=');
+            if(equals == NULL)
+               fallback = strtod(optarg, NULL);
+            else if(numThresholds == MAX_THRESHOLDS) {
+               Cmp_usage(argv[0]);
+               return 2;
+            }
+            else {
+               *equals = '\0';
+               thresholds[numThresholds].name = optarg;
+               thresholds[numThresholds].percent =
+                  strtod(equals + 1, NULL);
+               numThresholds++;
+            }
+            break;
+         default:
+            Cmp_usage(argv[0]);
+            return 2;
+      }
+   }
+   if(optind != argc - 2 || strlen(metric) >= MAX_FIELD ||
+      alpha <= 0.0 || alpha >= 1.0) {
+      Cmp_usage(argv[0]);
+      return 2;
+   }
+   isHigherBetter = !strcmp(metric, "opsPerSec");
+
+   base = Cmp_load(argv[optind], metric);
+   if(base == NULL)
+      return 2;
+   cand = Cmp_load(argv[optind + 1], metric);
+   if(cand == NULL) {
+      Cmp_freeRows(base);
+      return 2;
+   }
+
+   printf("%-8s %-20s %4s %12s %4s %12s %8s %8s  %s\n", "engine",
+          "workload", "runs", "baseline", "runs", "candidate",
+          "change", "p", "verdict");
+   while(nextBase < DynArray_getLength(base) ||
+         nextCand < DynArray_getLength(cand)) {
+      baseRow = nextBase < DynArray_getLength(base) ?
+         DynArray_get(base, nextBase) : NULL;
+      candRow = nextCand < DynArray_getLength(cand) ?
+         DynArray_get(cand, nextCand) : NULL;
+      if(baseRow == NULL)
+         order = 1;
+      else if(candRow == NULL)
+         order = -1;
+      else
+         order = Cmp_compareRows(baseRow, candRow);
+
+      if(order < 0) {
+         Cmp_summarize(base, &nextBase, &baseSample);
+         printf("%-8s %-20s %4lu %12.0f %4s %12s %8s %8s  %s\n",
+                baseRow->engine, baseRow->name,
+                (unsigned long) baseSample.n, baseSample.mean, "", "-",
+                "", "", "missing");
+         continue;
+      }
+      if(order > 0) {
+         Cmp_summarize(cand, &nextCand, &candSample);
+         printf("%-8s %-20s %4s %12s %4lu %12.0f %8s %8s  %s\n",
+                candRow->engine, candRow->name, "", "-",
+                (unsigned long) candSample.n, candSample.mean, "", "",
+                "new");
+         continue;
+      }
+
+      Cmp_summarize(base, &nextBase, &baseSample);
+      Cmp_summarize(cand, &nextCand, &candSample);
+      change = baseSample.mean == 0.0 ? 0.0 :
+         100.0 * (candSample.mean - baseSample.mean) / baseSample.mean;
+      worse = isHigherBetter ? -change : change;
+      limit = Cmp_thresholdFor(baseRow->name, thresholds,
+                               numThresholds, fallback);
+
+      if(baseSample.n >= 2 && candSample.n >= 2) {
+         p = Cmp_welch(&baseSample, &candSample);
+         isSignificant = p < alpha;
+         (void) sprintf(pText, "%.4f", p);
+      }
+      else {
+         isSignificant = TRUE;
+         (void) strcpy(pText, "n/a");
+      }
+
+      if(worse > limit && isSignificant) {
+         verdict = "REGRESSION";
+         regressions++;
+      }
+      else if(-worse > limit && isSignificant)
+         verdict = "improved";
+      else if(fabs(worse) > limit)
+         verdict = "noise";
+      else
+         verdict = "ok";
+
+      printf("%-8s %-20s %4lu %12.0f %4lu %12.0f %+7.1f%% %8s  %s\n",
+             baseRow->engine, baseRow->name,
+             (unsigned long) baseSample.n, baseSample.mean,
+             (unsigned long) candSample.n, candSample.mean, change,
+             pText, verdict);
+   }
+   printf("%lu regression(s) in %s\n", (unsigned long) regressions,
+          metric);
+
+   Cmp_freeRows(base);
+   Cmp_freeRows(cand);
+   return regressions == 0 ? 0 : 1;
+}
@@ -9,6 +9,20 @@
 #include <stdio.h>
 #include <string.h>
 #include "ft.h"
+#include "node.h"
+#include "checker.h"
+
+/* The depth of the chain that tests for recursion on depth. */
+enum { DEEP_LEVELS = 5000 };
+
+/* The number of children of the directory that tests chunked
+   children; several chunks' worth. */
+enum { WIDE_CHILDREN = 3000 };
+
+/* The number of children of the directory that tests validation by
+   the checker's pool of threads; more Nodes than it checks on the
+   calling thread. */
+enum { LARGE_CHILDREN = 5000 };
 
 /* Tests the FT implementation with an assortment of checks.
    Prints the status of the data structure along the way to stderr.
@@ -17,6 +31,26 @@ int main(void) {
   char* temp;
   boolean b;
   size_t l;
+  size_t m;
+  struct FT_stats stats;
+  struct FT_memory memory;
+  const char* engineName;
+  size_t e;
+  FILE* trace;
+  long traceLength;
+  char name[16];
+  char* line;
+  char* previous;
+  void* contents;
+  size_t length;
+  struct FT_handle dir;
+  struct FT_handle file;
+  struct FT_handle other;
+  Node node;
+  Node child;
+  char* batch[] = { "r/a/f", "r", "r/ab", "r/a/b/", "r/a/f/g", "s/a",
+                    "r/a/b", "r/a", "r/a/f", "r/a/bc", "r/ab/x" };
+  struct FT_statResult results[sizeof(batch) / sizeof(batch[0])];
 
   /* Before the data structure is initialized, insert*, remove*,
      and destroy operations should return INITIALIZATION_ERROR, and
@@ -171,10 +205,361 @@ int main(void) {
   fprintf(stderr, "%s\n", temp);
   free(temp);
 
+  /* the memory report accounts for every node */
+  assert(FT_memoryReport(&memory) == SUCCESS);
+  assert(memory.nodes == 12);
+  assert(memory.contentBytes == 8 + 9);
+  assert(memory.totalBytes == memory.nodeBytes + memory.pathBytes
+         + memory.childHeaderBytes + memory.childArrayBytes
+         + memory.childArraySlackBytes + memory.indexBytes
+         + memory.filterBytes);
+  assert(memory.bytesPerNode == memory.totalBytes / 12);
+
   assert(FT_destroy() == SUCCESS);
   assert(FT_destroy() == INITIALIZATION_ERROR);
+  assert(FT_memoryReport(&memory) == INITIALIZATION_ERROR);
   assert(FT_containsDir("a") == FALSE);
   assert(FT_containsFile("a") == FALSE);
 
+  /* statistics count every call, and can be reset */
+  FT_getStats(&stats);
+#ifndef NSTATS
+  assert(stats.calls[FT_OP_INIT] == 1);
+  assert(stats.calls[FT_OP_DESTROY] == 2);
+  assert(stats.calls[FT_OP_CONTAINS_FILE] > 0);
+  assert(stats.lookups > 0);
+  assert(stats.nodesVisited > 0);
+  assert(stats.mallocs[FT_SUB_NODE] > 0);
+  assert(stats.mallocs[FT_SUB_NODE] == stats.frees[FT_SUB_NODE]);
+  assert(stats.mallocs[FT_SUB_DYNARRAY] ==
+         stats.frees[FT_SUB_DYNARRAY]);
+  assert(FT_getLatency(FT_OP_INSERT_DIR, 0.5) <=
+         FT_getLatency(FT_OP_INSERT_DIR, 0.99));
+  assert(FT_getLatency(FT_OP_INSERT_DIR, 1.0) > 0);
+#endif
+  FT_dumpLatency(stderr, FALSE);
+  FT_dumpLatency(stderr, TRUE);
+  FT_resetStats();
+  FT_getStats(&stats);
+  assert(stats.calls[FT_OP_INIT] == 0);
+  assert(stats.lookups == 0);
+  assert(FT_getLatency(FT_OP_INSERT_DIR, 1.0) == 0);
+
+  /* every engine finds the same children, matching whole names only,
+     and the engine can only be chosen while not initialized */
+  assert(FT_setEngine("no such engine") == NO_SUCH_PATH);
+  assert(!strcmp(FT_getEngineName(0), "sorted"));
+  for(e = 0; (engineName = FT_getEngineName(e)) != NULL; e++) {
+    assert(FT_setEngine(engineName) == SUCCESS);
+    assert(FT_init() == SUCCESS);
+    assert(FT_setEngine(engineName) == INITIALIZATION_ERROR);
+    assert(FT_insertDir("r/ab") == SUCCESS);
+    assert(FT_insertDir("r/abc/d") == SUCCESS);
+    assert(FT_insertFile("r/a", NULL, 0) == SUCCESS);
+    assert(FT_insertFile("r/b", NULL, 0) == SUCCESS);
+    assert(FT_containsDir("r/abc/d") == TRUE);
+    assert(FT_containsDir("r/ab/d") == FALSE);
+    assert(FT_containsFile("r/a") == TRUE);
+    assert(FT_containsDir("r/a") == FALSE);
+    assert(FT_insertDir("r/a/x") == NOT_A_DIRECTORY);
+    assert(FT_rmFile("r/a/x") == NO_SUCH_PATH);
+    assert(FT_insertFile("r/abcdefgh", NULL, 0) == SUCCESS);
+    assert(FT_insertDir("r/abcdefghi") == SUCCESS);
+    assert(FT_insertFile("r/abcdefghi", NULL, 0) == ALREADY_IN_TREE);
+    assert(FT_containsFile("r/abcdefgh") == TRUE);
+    assert(FT_containsDir("r/abcdefghi") == TRUE);
+    assert(FT_rmFile("r/abcdefgh") == SUCCESS);
+    assert(FT_rmDir("r/abcdefghi") == SUCCESS);
+    assert(FT_insertDir("r/b") == ALREADY_IN_TREE);
+    assert(FT_rmFile("r/b") == SUCCESS);
+    assert(FT_rmDir("r/abc") == SUCCESS);
+    assert(FT_containsDir("r/abc") == FALSE);
+    assert(FT_containsDir("r/ab") == TRUE);
+    assert(FT_insertFile("r/x", NULL, 0) == SUCCESS);
+    assert(FT_insertFile("r/xy", NULL, 0) == SUCCESS);
+    assert(FT_rmFile("r/xy") == SUCCESS);
+    assert(FT_containsFile("r/x") == TRUE);
+    assert(FT_containsFile("r/xy") == FALSE);
+    assert(FT_rmFile("r/x") == SUCCESS);
+    assert(FT_memoryReport(&memory) == SUCCESS);
+    assert(memory.nodes == 3);
+    assert((memory.indexBytes == 0) == (e == 0));
+    assert(FT_destroy() == SUCCESS);
+  }
+  assert(e == 3);
+  assert(FT_setEngine("sorted") == SUCCESS);
+#ifndef NSTATS
+  FT_getStats(&stats);
+  assert(stats.mallocs[FT_SUB_ENGINE] > 0);
+  assert(stats.mallocs[FT_SUB_ENGINE] == stats.frees[FT_SUB_ENGINE]);
+#endif
+
+  /* a directory of several chunks of children keeps them in order as
+     it grows and empties, whatever the order of the changes, and
+     filters their names while it is large if the engine keeps no
+     index */
+  for(e = 0; (engineName = FT_getEngineName(e)) != NULL; e++) {
+    assert(FT_setEngine(engineName) == SUCCESS);
+    assert(FT_init() == SUCCESS);
+    for(l = 0; l < WIDE_CHILDREN; l++) {
+      sprintf(name, "w/%c%05lu", l % 2 ? 'f' : 'd',
+              (unsigned long) (l * 7919 % WIDE_CHILDREN));
+      if(l % 2)
+        assert(FT_insertFile(name, NULL, 0) == SUCCESS);
+      else
+        assert(FT_insertDir(name) == SUCCESS);
+    }
+    assert(FT_insertFile("w/f00003", NULL, 0) == ALREADY_IN_TREE);
+    assert(FT_containsFile("w/f00003") == TRUE);
+    assert(FT_containsDir("w/d00000") == TRUE);
+    assert(FT_containsFile("w/d00000") == FALSE);
+    assert(FT_containsFile("w/f00002") == FALSE);
+    assert(FT_memoryReport(&memory) == SUCCESS);
+    assert((memory.filterBytes != 0) == (e == 0));
+    temp = FT_toString();
+    assert(temp != NULL);
+    assert(!strcmp(strtok(temp, "\n"), "w"));
+    previous = strtok(NULL, "\n");
+    for(l = 1; (line = strtok(NULL, "\n")) != NULL; l++) {
+      assert(previous[2] == line[2] ? strcmp(previous, line) < 0
+             : previous[2] == 'f');
+      previous = line;
+    }
+    assert(l == WIDE_CHILDREN);
+    free(temp);
+    for(m = 0; m < WIDE_CHILDREN; m++) {
+      l = m * 1999 % WIDE_CHILDREN;
+      sprintf(name, "w/%c%05lu", l % 2 ? 'f' : 'd',
+              (unsigned long) (l * 7919 % WIDE_CHILDREN));
+      if(l % 2)
+        assert(FT_rmFile(name) == SUCCESS);
+      else
+        assert(FT_rmDir(name) == SUCCESS);
+      assert(FT_containsFile(name) == FALSE);
+    }
+    assert(FT_memoryReport(&memory) == SUCCESS);
+    assert(memory.nodes == 1);
+    assert(memory.filterBytes == 0);
+    assert(FT_destroy() == SUCCESS);
+  }
+  assert(FT_setEngine("sorted") == SUCCESS);
+
+  /* a deep chain is walked, dumped and destroyed without recursion */
+  temp = malloc(2 * DEEP_LEVELS + 2);
+  assert(temp != NULL);
+  temp[0] = 'r';
+  for(l = 0; l < DEEP_LEVELS; l++) {
+    temp[2 * l + 1] = '/';
+    temp[2 * l + 2] = 'd';
+  }
+  temp[2 * DEEP_LEVELS + 1] = '\0';
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDir(temp) == SUCCESS);
+  assert(FT_containsDir(temp) == TRUE);
+  assert(FT_validate() == TRUE);
+  assert(FT_memoryReport(&memory) == SUCCESS);
+  assert(memory.nodes == DEEP_LEVELS + 1);
+  free(temp);
+  temp = FT_toString();
+  assert(temp != NULL);
+  free(temp);
+  assert(FT_destroy() == SUCCESS);
+
+  /* the checker validates small trees on the calling thread and large
+     ones with its pool of threads, and rejects a wrong count either
+     way */
+  assert(FT_validate() == TRUE);
+  assert(FT_init() == SUCCESS);
+  assert(FT_validate() == TRUE);
+  assert(FT_ensureDir("r/a/b") == SUCCESS);
+  assert(FT_insertFile("r/a/f", NULL, 0) == SUCCESS);
+  assert(FT_validate() == TRUE);
+  for(l = 0; l < LARGE_CHILDREN; l++) {
+    sprintf(name, "r/%c%05lu", l % 2 ? 'f' : 'd', (unsigned long) l);
+    if(l % 2)
+      assert(FT_insertFile(name, NULL, 0) == SUCCESS);
+    else
+      assert(FT_insertDir(name) == SUCCESS);
+  }
+  assert(FT_validate() == TRUE);
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_validate() == TRUE);
+  node = Node_create("r", 1, NULL, FALSE);
+  assert(node != NULL);
+  for(l = 0; l < LARGE_CHILDREN; l++) {
+    sprintf(name, "d%05lu", (unsigned long) l);
+    child = Node_create(name, strlen(name), node, FALSE);
+    assert(child != NULL);
+    assert(Node_linkChild(node, child) == SUCCESS);
+    if(l == 0) {
+      assert(Checker_FT_isValid(TRUE, node, 2) == TRUE);
+      assert(Checker_FT_isValid(TRUE, node, 3) == FALSE);
+      assert(Checker_FT_isValid(FALSE, node, 2) == FALSE);
+    }
+  }
+  assert(Checker_FT_isValid(TRUE, node, LARGE_CHILDREN + 1) == TRUE);
+  assert(Checker_FT_isValid(TRUE, node, LARGE_CHILDREN) == FALSE);
+  assert(Checker_FT_isValid(TRUE, node, LARGE_CHILDREN + 2) == FALSE);
+  assert(Node_destroy(node) == LARGE_CHILDREN + 1);
+
+  /* doubled and trailing slashes name no nodes of their own */
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDir("r") == SUCCESS);
+  assert(FT_insertFile("r//a/f/", NULL, 0) == SUCCESS);
+  assert(FT_containsFile("r/a/f") == TRUE);
+  assert(FT_insertDir("r/a/") == ALREADY_IN_TREE);
+  assert(FT_memoryReport(&memory) == SUCCESS);
+  assert(memory.nodes == 3);
+  assert(FT_destroy() == SUCCESS);
+
+  /* paths may be slices of a larger buffer */
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDirN("r/a/bXYZ", 5) == SUCCESS);
+  assert(FT_containsDir("r/a/b") == TRUE);
+  assert(FT_containsDirN("r/a/bc", 5) == TRUE);
+  assert(FT_containsDirN("r/a/bc", 4) == FALSE);
+  assert(FT_insertFileN("r/a/fg", 5, NULL, 3) == SUCCESS);
+  assert(FT_insertFileN("r/a/fg", 5, NULL, 3) == ALREADY_IN_TREE);
+  assert(FT_statN("r/a/f/", 5, &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 3);
+  assert(FT_rmFileN("r/a/ff", 5) == SUCCESS);
+  assert(FT_containsFile("r/a/f") == FALSE);
+  assert(FT_destroy() == SUCCESS);
+
+  /* mkdir -p and create-or-overwrite succeed either way */
+  assert(FT_ensureDir("r/a") == INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  assert(FT_ensureDir("r/a/b") == SUCCESS);
+  assert(FT_ensureDir("r/a/b") == SUCCESS);
+  assert(FT_ensureDir("r/a/") == SUCCESS);
+  assert(FT_ensureDir("s") == CONFLICTING_PATH);
+  assert(FT_upsertFile("r/a/f", "one", 4, &contents) == SUCCESS);
+  assert(contents == NULL);
+  assert(FT_upsertFile("r/a/f", "two", 4, &contents) == SUCCESS);
+  assert(!strcmp(contents, "one"));
+  assert(!strcmp(FT_getFileContents("r/a/f"), "two"));
+  assert(FT_upsertFile("r/a/b", NULL, 0, NULL) == NOT_A_FILE);
+  assert(FT_upsertFile("r/a/f/g", NULL, 0, NULL) == NOT_A_DIRECTORY);
+  assert(FT_ensureDir("r/a/f") == NOT_A_DIRECTORY);
+  assert(FT_memoryReport(&memory) == SUCCESS);
+  assert(memory.nodes == 4);
+  assert(FT_destroy() == SUCCESS);
+
+  /* a batch of stats, sorted or interleaved, agrees with FT_stat on
+     each path and counts one lookup for each */
+  m = sizeof(batch) / sizeof(batch[0]);
+  assert(FT_statMany(batch, m, results) == INITIALIZATION_ERROR);
+  assert(FT_statBatch(batch, m, results) == INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  assert(FT_ensureDir("r/a/b") == SUCCESS);
+  assert(FT_insertFile("r/a/f", NULL, 3) == SUCCESS);
+  assert(FT_insertDir("r/ab") == SUCCESS);
+  assert(FT_statMany(batch, 0, NULL) == SUCCESS);
+  assert(FT_statBatch(batch, 0, NULL) == SUCCESS);
+  for(e = 0; e < 2; e++) {
+    FT_resetStats();
+    if(e == 0)
+      assert(FT_statMany(batch, m, results) == SUCCESS);
+    else
+      assert(FT_statBatch(batch, m, results) == SUCCESS);
+#ifndef NSTATS
+    FT_getStats(&stats);
+    assert(stats.lookups == m);
+#endif
+    for(l = 0; l < m; l++) {
+      assert(results[l].status == FT_stat(batch[l], &b, &length));
+      if(results[l].status == SUCCESS)
+        assert(results[l].type == b &&
+               results[l].length == (b ? length : 0));
+    }
+    assert(results[0].status == SUCCESS && results[0].length == 3);
+    assert(results[5].status == NO_SUCH_PATH);
+  }
+  assert(FT_destroy() == SUCCESS);
+
+  /* consecutive lookups resume from where the last one ended, but
+     never from a Node that has been removed since */
+  assert(FT_init() == SUCCESS);
+  assert(FT_ensureDir("r/a/b") == SUCCESS);
+  assert(FT_insertFile("r/a/b/f", NULL, 1) == SUCCESS);
+  FT_resetStats();
+  assert(FT_stat("r/a/b/f", &b, &l) == SUCCESS);
+  assert(FT_stat("r/a/b/g", &b, &l) == NO_SUCH_PATH);
+  assert(FT_stat("r", &b, &l) == SUCCESS && b == FALSE);
+#ifndef NSTATS
+  FT_getStats(&stats);
+  assert(stats.lookups == 3 && stats.fingerHits == 2);
+#endif
+  assert(FT_rmDir("r/a/b") == SUCCESS);
+  assert(FT_stat("r/a/b/f", &b, &l) == NO_SUCH_PATH);
+  assert(FT_insertFile("r/a/b/f", NULL, 2) == SUCCESS);
+  assert(FT_stat("r/a/b/f", &b, &l) == SUCCESS && l == 2);
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDir("r") == SUCCESS);
+  assert(FT_containsFile("r/a/b/f") == FALSE);
+  assert(FT_destroy() == SUCCESS);
+
+  /* handles reach a Node without its path until it is removed */
+  assert(FT_open("r", &dir) == INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  assert(FT_ensureDir("r/a") == SUCCESS);
+  assert(FT_open("r/x", &dir) == NO_SUCH_PATH);
+  assert(FT_open("r/a", &dir) == SUCCESS);
+  assert(FT_open("r/a", &other) == SUCCESS);
+  assert(other.slot == dir.slot && other.generation == dir.generation);
+  assert(FT_insertFileAt(dir, "f", "one", 4) == SUCCESS);
+  assert(FT_insertFileAt(dir, "f", NULL, 0) == ALREADY_IN_TREE);
+  assert(FT_insertFileAt(dir, "b/g", NULL, 2) == SUCCESS);
+  assert(FT_insertFileAt(dir, "f/g", NULL, 0) == NOT_A_DIRECTORY);
+  assert(FT_insertFileAt(dir, "", NULL, 0) == ALREADY_IN_TREE);
+  assert(FT_containsFile("r/a/b/g") == TRUE);
+  assert(FT_statAt(dir, "b/g", &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 2);
+  assert(FT_statAt(dir, "", &b, &l) == SUCCESS && b == FALSE);
+  assert(FT_statAt(dir, "b/x", &b, &l) == NO_SUCH_PATH);
+  assert(FT_listAt(dir, &temp) == SUCCESS);
+  assert(!strcmp(temp, "f\nb\n"));
+  free(temp);
+  assert(FT_open("r/a/f", &file) == SUCCESS);
+  assert(!strcmp(FT_getFileContentsById(file), "one"));
+  assert(FT_getFileContentsById(dir) == NULL);
+  assert(FT_listAt(file, &temp) == NOT_A_DIRECTORY);
+  assert(FT_insertFileAt(file, "g", NULL, 0) == NOT_A_DIRECTORY);
+  assert(FT_rmFile("r/a/f") == SUCCESS);
+  assert(FT_getFileContentsById(file) == NULL);
+  assert(FT_close(file) == NO_SUCH_PATH);
+  assert(FT_close(dir) == SUCCESS);
+  assert(FT_statAt(dir, "", &b, &l) == NO_SUCH_PATH);
+  assert(FT_open("r/a/b", &other) == SUCCESS);
+  assert(FT_statAt(other, "g", &b, &l) == SUCCESS);
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDir("r") == SUCCESS);
+  assert(FT_statAt(other, "", &b, &l) == NO_SUCH_PATH);
+  assert(FT_open("r", &dir) == SUCCESS);
+  assert(FT_close(other) == NO_SUCH_PATH);
+  assert(FT_destroy() == SUCCESS);
+
+  /* calls are recorded only between FT_startTrace and FT_stopTrace */
+  trace = tmpfile();
+  assert(trace != NULL);
+  assert(FT_stopTrace() == INITIALIZATION_ERROR);
+  assert(FT_startTrace(trace) == SUCCESS);
+  assert(FT_startTrace(trace) == INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertFile("r/f", NULL, 5) == SUCCESS);
+  assert(FT_stat("r/f", &b, &l) == SUCCESS);
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_stopTrace() == SUCCESS);
+  traceLength = ftell(trace);
+  /* the header, then 4 records of at least 5 bytes plus their paths */
+  assert(traceLength >= 8 + 4 * 5 + 2 * 3);
+  assert(FT_init() == SUCCESS);
+  assert(FT_destroy() == SUCCESS);
+  assert(ftell(trace) == traceLength);
+  assert(FT_stopTrace() == INITIALIZATION_ERROR);
+  fclose(trace);
+
   return 0;
 }
@@ -0,0 +1,606 @@
+/*--------------------------------------------------------------------*/
+/* ft_gen.c                                                           */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "a4def.h"
+#include "dynarray.h"
+#include "manifest.h"
+#include "bench.h"
+
+/* The longest name the generator makes, including its '\0'. */
+enum { MAX_NAME = 64 };
+
+/* The most ranks the access-skew distribution distinguishes; larger
+   trees fold their paths onto these ranks. */
+enum { MAX_RANKS = 1 << 22 };
+
+/* The generator parameters, as given on the command line. */
+struct genConfig {
+   /* the number of Nodes in the generated hierarchy */
+   size_t nodes;
+   /* the most files generated in one directory */
+   size_t maxFanout;
+   /* the Zipf exponent of the number of files per directory */
+   double fileSkew;
+   /* the chance that a new directory starts a deep chain */
+   double deepChance;
+   /* the mean number of directories in a deep chain */
+   size_t deepMean;
+   /* the number of operations in the trace */
+   size_t ops;
+   /* the percentages of lookups, inserts and removals in the trace */
+   size_t mix[3];
+   /* the Zipf exponent of which paths the trace looks up, or 0 for
+      uniformly random lookups */
+   double accessSkew;
+   /* the seed of the pseudo-random number generator */
+   unsigned long seed;
+};
+
+/* The kinds of trace operation, indexing genConfig.mix. */
+enum { GEN_LOOKUP, GEN_INSERT, GEN_REMOVE, GEN_KINDS };
+
+/* A Zipf distribution over 0..n-1, where k has weight 1/(k+1)^s. */
+struct zipf {
+   /* the cumulative probability of each value */
+   double* cdf;
+   /* the number of values */
+   size_t n;
+};
+
+/* Directory names common enough in real trees to repeat, most common
+   first. */
+static const char* commonDirs[] = {
+   "src", "lib", "test", "include", "docs", "bin", "build", ".git",
+   "node_modules", "tests", "assets", "config", "scripts", "data",
+   "images", "static", "util", "internal", "vendor", "tmp", "cache",
+   "logs", "api", "core", "common", "res", "main", "v1", "v2", "dist"
+};
+
+/* File names common enough in real trees to repeat, most common
+   first. */
+static const char* commonFiles[] = {
+   "README.md", "Makefile", "index.js", "__init__.py", ".gitignore",
+   "LICENSE", "package.json", "main.c", "index.html", "config.yaml",
+   "setup.py", "CMakeLists.txt", "go.mod", "Cargo.toml", "build.gradle"
+};
+
+/* File name extensions, most common first. */
+static const char* extensions[] = {
+   ".c", ".h", ".js", ".py", ".txt", ".json", ".md", ".png", ".o",
+   ".html", ".java", ".go", ".log", ".css", ".jpg", ".so", ".xml"
+};
+
+/* The distributions of names, extensions, file counts and lookups. */
+static struct zipf dirNameZipf;
+static struct zipf fileNameZipf;
+static struct zipf extensionZipf;
+static struct zipf fileZipf;
+static struct zipf accessZipf;
+
+/* Counters of what has been generated, for the summary. */
+static size_t numDirs;
+static size_t numFiles;
+static size_t maxDepth;
+static size_t totalDepth;
+
+/*--------------------------------------------------------------------*/
+
+/* Prints that the generator ran out of memory and exits. */
+static void Gen_outOfMemory(void) {
+   fprintf(stderr, "ft_gen: out of memory\n");
+   exit(EXIT_FAILURE);
+}
+
+/* Returns a pseudo-random number uniformly distributed in [0, 1). */
+static double Gen_uniform(void) {
+   return (double) ((Bench_random() >> 11) & 0xFFFFFFFFUL)
+      / 4294967296.0;
+}
+
+/* Sets *pZipf to the Zipf distribution over 0..n-1 with exponent
+   skew. */
+static void Gen_zipfInit(struct zipf* pZipf, size_t n, double skew) {
+   double total = 0;
+   size_t k;
+
+   assert(n > 0);
+
+   pZipf->cdf = malloc(n * sizeof(double));
+   if(pZipf->cdf == NULL)
+      Gen_outOfMemory();
+   pZipf->n = n;
+   for(k = 0; k < n; k++) {
+      total += 1.0 / pow((double) (k + 1), skew);
+      pZipf->cdf[k] = total;
+   }
+   for(k = 0; k < n; k++)
+      pZipf->cdf[k] /= total;
+}
+
+/* Returns a value drawn from the distribution *pZipf. */
+static size_t Gen_zipf(const struct zipf* pZipf) {
+   double u = Gen_uniform();
+   size_t lo = 0;
+   size_t hi = pZipf->n - 1;
+   size_t mid;
+
+   while(lo < hi) {
+      mid = lo + (hi - lo) / 2;
+      if(pZipf->cdf[mid] <= u)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+/* Returns a file length drawn from a Pareto distribution, as file
+   sizes are: mostly small, with a long tail of very large files. A
+   few files are empty. */
+static size_t Gen_fileLength(void) {
+   double u = 1.0 - Gen_uniform();
+   double length;
+
+   if(Bench_random() % 20 == 0)
+      return 0;
+   length = 256.0 / pow(u, 1.0 / 1.2);
+   if(length > 1073741824.0)
+      length = 1073741824.0;
+   return (size_t) length;
+}
+
+/* Writes to name a random name of 2 to about 30 characters, most
+   around 8 long, with an extension if isFile is TRUE. */
+static void Gen_randomName(char* name, boolean isFile) {
+   static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+   static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_";
+   size_t length;
+   size_t i;
+
+   length = 2 + Bench_random() % 6 + Bench_random() % 6;
+   if(Bench_random() % 4 == 0)
+      length += Bench_random() % 16;
+
+   name[0] = letters[Bench_random() % (sizeof(letters) - 1)];
+   for(i = 1; i < length; i++)
+      name[i] = chars[Bench_random() % (sizeof(chars) - 1)];
+   name[length] = '\0';
+   if(isFile)
+      strcat(name, extensions[Gen_zipf(&extensionZipf)]);
+}
+
+/* Returns TRUE if the array of names used contains name. */
+static boolean Gen_isUsed(DynArray_T used, const char* name) {
+   size_t i;
+
+   for(i = 0; i < DynArray_getLength(used); i++)
+      if(!strcmp(DynArray_get(used, i), name))
+         return TRUE;
+   return FALSE;
+}
+
+/* Writes to name a name for a new child, a file if isFile is TRUE,
+   of a directory whose children already have the names in used:
+   sometimes a common name, otherwise a random one. */
+static void Gen_childName(char* name, boolean isFile, DynArray_T used) {
+   if(isFile ? Bench_random() % 100 < 15 : Bench_random() % 100 < 30) {
+      strcpy(name, isFile ? commonFiles[Gen_zipf(&fileNameZipf)]
+                          : commonDirs[Gen_zipf(&dirNameZipf)]);
+      if(!Gen_isUsed(used, name))
+         return;
+   }
+   do
+      Gen_randomName(name, isFile);
+   while(Gen_isUsed(used, name));
+}
+
+/* Returns a new path, owned by the caller, of parent and name joined
+   by a slash. */
+static char* Gen_join(const char* parent, const char* name) {
+   char* path = malloc(strlen(parent) + 1 + strlen(name) + 1);
+
+   if(path == NULL)
+      Gen_outOfMemory();
+   strcpy(path, parent);
+   strcat(path, "/");
+   strcat(path, name);
+   return path;
+}
+
+/* Returns the depth of path: the number of slashes in it. */
+static size_t Gen_depth(const char* path) {
+   size_t depth = 0;
+
+   for(; *path != '\0'; path++)
+      if(*path == '/')
+         depth++;
+   return depth;
+}
+
+/* Adds path, which is a file if isFile is TRUE, to all (every path of
+   that kind) and to the summary, and writes it to stream. */
+static void Gen_emit(FILE* stream, DynArray_T all, char* path,
+                     boolean isFile) {
+   size_t depth = Gen_depth(path);
+
+   if(!DynArray_add(all, path))
+      Gen_outOfMemory();
+   if(isFile) {
+      Manifest_write(stream, MANIFEST_FILE, path, Gen_fileLength());
+      numFiles++;
+   }
+   else {
+      Manifest_write(stream, MANIFEST_DIR, path, 0);
+      numDirs++;
+   }
+   totalDepth += depth;
+   if(depth > maxDepth)
+      maxDepth = depth;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A directory of the hierarchy being generated. */
+struct genDir {
+   /* its path */
+   char* path;
+   /* the names of its children, which point into their paths */
+   DynArray_T names;
+};
+
+/* Returns the mean of the distribution *pZipf. */
+static double Gen_zipfMean(const struct zipf* pZipf) {
+   double mean = 0;
+   double previous = 0;
+   size_t k;
+
+   for(k = 0; k < pZipf->n; k++) {
+      mean += (double) k * (pZipf->cdf[k] - previous);
+      previous = pZipf->cdf[k];
+   }
+   return mean;
+}
+
+/* Creates a child of *parent named name, a file if isFile is TRUE,
+   writes it to stream and adds its path to paths. Returns the path. */
+static char* Gen_addChild(struct genDir* parent, const char* name,
+                          boolean isFile, FILE* stream,
+                          DynArray_T paths) {
+   char* path = Gen_join(parent->path, name);
+
+   Gen_emit(stream, paths, path, isFile);
+   if(!DynArray_add(parent->names, path + strlen(parent->path) + 1))
+      Gen_outOfMemory();
+   return path;
+}
+
+/* Returns a new genDir for path, and gives it its weight in tickets:
+   two tickets, plus one for its parent for each new subdirectory. */
+static struct genDir* Gen_newDir(char* path, struct genDir* parent,
+                                 DynArray_T tickets) {
+   struct genDir* dir = malloc(sizeof(struct genDir));
+
+   if(dir == NULL)
+      Gen_outOfMemory();
+   dir->path = path;
+   dir->names = DynArray_new(0);
+   if(dir->names == NULL || !DynArray_add(tickets, dir) ||
+      !DynArray_add(tickets, dir) ||
+      (parent != NULL && !DynArray_add(tickets, parent)))
+      Gen_outOfMemory();
+   return dir;
+}
+
+/*
+   Generates a hierarchy of about cfg->nodes Nodes and writes it to
+   stream as a manifest, storing every directory path in dirs and
+   every file path in files.
+
+   Directories are created first, each under a parent chosen with
+   weight two plus the parent's number of subdirectories, which gives
+   the Poisson-like depths and skewed subdirectory counts of real
+   trees; a few directories also start a thin chain of nested
+   directories, which gives the long tail of deep paths. Then every
+   directory gets a Zipf-distributed number of files.
+*/
+static void Gen_tree(const struct genConfig* cfg, FILE* stream,
+                     DynArray_T dirs, DynArray_T files) {
+   DynArray_T genDirs = DynArray_new(0);
+   DynArray_T tickets = DynArray_new(0);
+   struct genDir* dir;
+   struct genDir* parent;
+   char name[MAX_NAME + 24];
+   char* path;
+   size_t targetDirs;
+   size_t nodes = 1;
+   size_t numChildFiles;
+   size_t d;
+   size_t i;
+   boolean isChain;
+
+   if(genDirs == NULL || tickets == NULL)
+      Gen_outOfMemory();
+
+   targetDirs = (size_t) ((double) cfg->nodes
+                          / (1.0 + Gen_zipfMean(&fileZipf)));
+   if(targetDirs == 0)
+      targetDirs = 1;
+
+   path = malloc(2);
+   if(path == NULL)
+      Gen_outOfMemory();
+   strcpy(path, "r");
+   Gen_emit(stream, dirs, path, FALSE);
+   if(!DynArray_add(genDirs, Gen_newDir(path, NULL, tickets)))
+      Gen_outOfMemory();
+
+   while(nodes < targetDirs) {
+      parent = DynArray_get(tickets,
+                            Bench_random() % DynArray_getLength(tickets));
+      isChain = Gen_uniform() < cfg->deepChance;
+      do {
+         Gen_childName(name, FALSE, parent->names);
+         dir = Gen_newDir(Gen_addChild(parent, name, FALSE, stream,
+                                       dirs), parent, tickets);
+         if(!DynArray_add(genDirs, dir))
+            Gen_outOfMemory();
+         nodes++;
+         parent = dir;
+      } while(isChain && nodes < targetDirs &&
+              Gen_uniform() * (double) cfg->deepMean >= 1);
+   }
+
+   for(d = 0; d < DynArray_getLength(genDirs) && nodes < cfg->nodes;
+       d++) {
+      dir = DynArray_get(genDirs, d);
+      numChildFiles = Gen_zipf(&fileZipf);
+      for(i = 0; i < numChildFiles && nodes < cfg->nodes; i++) {
+         Gen_childName(name, TRUE, dir->names);
+         (void) Gen_addChild(dir, name, TRUE, stream, files);
+         nodes++;
+      }
+   }
+   /* Make up any shortfall with uniquely named files. */
+   for(i = 0; nodes < cfg->nodes; i++) {
+      dir = DynArray_get(genDirs,
+                         Bench_random() % DynArray_getLength(genDirs));
+      Gen_randomName(name, FALSE);
+      (void) sprintf(name + strlen(name), "-%lu%s", (unsigned long) i,
+                     extensions[Gen_zipf(&extensionZipf)]);
+      (void) Gen_addChild(dir, name, TRUE, stream, files);
+      nodes++;
+   }
+
+   for(d = 0; d < DynArray_getLength(genDirs); d++) {
+      dir = DynArray_get(genDirs, d);
+      DynArray_free(dir->names);
+      free(dir);
+   }
+   DynArray_free(tickets);
+   DynArray_free(genDirs);
+}
+
+/*
+   Writes a trace of cfg->ops operations on the hierarchy whose
+   directory and file paths are in dirs and files to stream, in the
+   proportions cfg->mix. Lookups stat an existing path, popular paths
+   more often if cfg->accessSkew is not 0; inserts add a uniquely
+   named file (nine times in ten) or directory to a random directory;
+   removals remove a random existing file.
+*/
+static void Gen_trace(const struct genConfig* cfg, FILE* stream,
+                      DynArray_T dirs, DynArray_T files) {
+   char name[MAX_NAME + 24];
+   char* path;
+   size_t total;
+   size_t index;
+   size_t roll;
+   size_t q;
+   int kind;
+   boolean isFile;
+
+   for(q = 0; q < cfg->ops; q++) {
+      roll = Bench_random() % 100;
+      for(kind = 0; kind < GEN_KINDS - 1; kind++) {
+         if(roll < cfg->mix[kind])
+            break;
+         roll -= cfg->mix[kind];
+      }
+      if(kind == GEN_REMOVE && DynArray_getLength(files) == 0)
+         kind = GEN_LOOKUP;
+
+      if(kind == GEN_LOOKUP) {
+         total = DynArray_getLength(dirs) + DynArray_getLength(files);
+         if(cfg->accessSkew > 0)
+            /* Scatter the popular ranks over the whole tree. */
+            index = (Gen_zipf(&accessZipf) * 2654435761UL) % total;
+         else
+            index = Bench_random() % total;
+         if(index < DynArray_getLength(files))
+            path = DynArray_get(files, index);
+         else
+            path = DynArray_get(dirs,
+                                index - DynArray_getLength(files));
+         Manifest_write(stream, MANIFEST_STAT, path, 0);
+      }
+      else if(kind == GEN_INSERT) {
+         isFile = Bench_random() % 10 != 0;
+         Gen_randomName(name, FALSE);
+         /* The '-' makes the name unlike any in the manifest. */
+         (void) sprintf(name + strlen(name), "-%lu", (unsigned long) q);
+         if(isFile)
+            strcat(name, extensions[Gen_zipf(&extensionZipf)]);
+         path = Gen_join(DynArray_get(dirs, Bench_random()
+                                      % DynArray_getLength(dirs)), name);
+         if(isFile) {
+            if(!DynArray_add(files, path))
+               Gen_outOfMemory();
+            Manifest_write(stream, MANIFEST_INSERT_FILE, path,
+                           Gen_fileLength());
+         }
+         else {
+            if(!DynArray_add(dirs, path))
+               Gen_outOfMemory();
+            Manifest_write(stream, MANIFEST_INSERT_DIR, path, 0);
+         }
+      }
+      else {
+         index = Bench_random() % DynArray_getLength(files);
+         path = DynArray_set(files, index, DynArray_get(files,
+                                DynArray_getLength(files) - 1));
+         (void) DynArray_removeAt(files, DynArray_getLength(files) - 1);
+         Manifest_write(stream, MANIFEST_RM_FILE, path, 0);
+         free(path);
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Frees every path in paths, and paths itself. */
+static void Gen_freePaths(DynArray_T paths) {
+   size_t i;
+
+   for(i = 0; i < DynArray_getLength(paths); i++)
+      free(DynArray_get(paths, i));
+   DynArray_free(paths);
+}
+
+/* Opens the file named filename for writing, or returns stdout if
+   filename is "-". Exits if the file cannot be opened. */
+static FILE* Gen_open(const char* filename) {
+   FILE* stream;
+
+   if(!strcmp(filename, "-"))
+      return stdout;
+   stream = fopen(filename, "w");
+   if(stream == NULL) {
+      fprintf(stderr, "ft_gen: cannot write %s\n", filename);
+      exit(EXIT_FAILURE);
+   }
+   return stream;
+}
+
+/* Prints how to invoke the program to stderr. */
+static void Gen_usage(const char* program) {
+   fprintf(stderr,
+      "usage: %s [-n nodes] [-f maxfiles] [-z fileskew]\n"
+      "          [-p deepchance] [-D deepmean] [-o manifest]\n"
+      "          [-T trace] [-q ops] [-m lookup,insert,remove]\n"
+      "          [-a accessskew] [-s seed]\n", program);
+}
+
+/* Generates a hierarchy whose depth, fanout and names are distributed
+   like a real file system's, and writes it as a manifest (see
+   manifest.h) to the -o file or stdout. With -T, also writes a trace
+   of operations on it. Prints a summary of the hierarchy to stderr.
+   Returns 0, or 1 if the command line is invalid. */
+int main(int argc, char* argv[]) {
+   struct genConfig cfg;
+   const char* manifestName = "-";
+   const char* traceName = NULL;
+   unsigned long mix[GEN_KINDS];
+   DynArray_T dirs;
+   DynArray_T files;
+   FILE* stream;
+   size_t ranks;
+   int option;
+
+   cfg.nodes = 10000;
+   cfg.maxFanout = 1000;
+   cfg.fileSkew = 1.6;
+   cfg.deepChance = 0.002;
+   cfg.deepMean = 24;
+   cfg.ops = 100000;
+   cfg.mix[GEN_LOOKUP] = 80;
+   cfg.mix[GEN_INSERT] = 15;
+   cfg.mix[GEN_REMOVE] = 5;
+   cfg.accessSkew = 0.99;
+   cfg.seed = 217;
+
+   while((option = getopt(argc, argv, "n:f:z:p:D:o:T:q:m:a:s:"))
+         != -1) {
+      switch(option) {
+         case 'n': cfg.nodes = strtoul(optarg, NULL, 10); break;
+         case 'f': cfg.maxFanout = strtoul(optarg, NULL, 10); break;
+         case 'p': cfg.deepChance = strtod(optarg, NULL); break;
+         case 'D': cfg.deepMean = strtoul(optarg, NULL, 10); break;
+         case 'o': manifestName = optarg; break;
+         case 'T': traceName = optarg; break;
+         case 'q': cfg.ops = strtoul(optarg, NULL, 10); break;
+         case 'a': cfg.accessSkew = strtod(optarg, NULL); break;
+         case 's': cfg.seed = strtoul(optarg, NULL, 10); break;
+         case 'z': cfg.fileSkew = strtod(optarg, NULL); break;
+         case 'm':
+            if(sscanf(optarg, "%lu,%lu,%lu", &mix[0], &mix[1],
+                      &mix[2]) != GEN_KINDS ||
+               mix[0] + mix[1] + mix[2] != 100) {
+               Gen_usage(argv[0]);
+               return 1;
+            }
+            cfg.mix[GEN_LOOKUP] = mix[0];
+            cfg.mix[GEN_INSERT] = mix[1];
+            cfg.mix[GEN_REMOVE] = mix[2];
+            break;
+         default:
+            Gen_usage(argv[0]);
+            return 1;
+      }
+   }
+   if(optind != argc || cfg.nodes == 0 || cfg.maxFanout == 0 ||
+      cfg.fileSkew <= 0 || cfg.accessSkew < 0 ||
+      cfg.deepChance < 0 || cfg.deepChance > 1 || cfg.deepMean == 0) {
+      Gen_usage(argv[0]);
+      return 1;
+   }
+
+   Bench_seed(cfg.seed);
+   Gen_zipfInit(&dirNameZipf, sizeof(commonDirs) / sizeof(char*), 1.0);
+   Gen_zipfInit(&fileNameZipf, sizeof(commonFiles) / sizeof(char*),
+                1.0);
+   Gen_zipfInit(&extensionZipf, sizeof(extensions) / sizeof(char*),
+                1.0);
+   Gen_zipfInit(&fileZipf, cfg.maxFanout + 1, cfg.fileSkew);
+
+   dirs = DynArray_new(0);
+   files = DynArray_new(0);
+   if(dirs == NULL || files == NULL)
+      Gen_outOfMemory();
+
+   stream = Gen_open(manifestName);
+   Gen_tree(&cfg, stream, dirs, files);
+   if(stream != stdout)
+      (void) fclose(stream);
+
+   fprintf(stderr, "ft_gen: %lu directories, %lu files, "
+           "depth mean %.1f max %lu\n", (unsigned long) numDirs,
+           (unsigned long) numFiles,
+           (double) totalDepth / (double) (numDirs + numFiles),
+           (unsigned long) maxDepth);
+
+   if(traceName != NULL) {
+      ranks = numDirs + numFiles;
+      if(ranks > MAX_RANKS)
+         ranks = MAX_RANKS;
+      Gen_zipfInit(&accessZipf, ranks, cfg.accessSkew);
+      stream = Gen_open(traceName);
+      Gen_trace(&cfg, stream, dirs, files);
+      if(stream != stdout)
+         (void) fclose(stream);
+   }
+
+   Gen_freePaths(files);
+   Gen_freePaths(dirs);
+   return 0;
+}
@@ -0,0 +1,258 @@
+/*--------------------------------------------------------------------*/
+/* ft_replay.c                                                        */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ft.h"
+#include "trace.h"
+#include "bench.h"
+
+/* The most engines that one run can compare. */
+enum { MAX_ENGINES = 16 };
+
+/* How close to the time of the next call, in ns, a timed replay stops
+   sleeping and starts spinning. */
+enum { SPIN_NS = 100000 };
+
+/* The names that the report gives the FT entry points, indexed by
+   enum FT_op. */
+static const char *opNames[FT_NUM_OPS] = {
+   "insertDir", "containsDir", "rmDir", "insertFile", "containsFile",
+   "rmFile", "getContents", "replaceContents", "stat", "init",
+   "destroy", "toString", "ensureDir", "upsertFile", "statMany",
+   "statBatch", "open", "close", "insertFileAt", "statAt",
+   "getContentsById", "listAt"
+};
+
+/* The contents that every replayed file is given, so that the entry
+   points that return contents return non-NULL exactly when they
+   succeed. */
+static char replayContents[] = "";
+
+/*--------------------------------------------------------------------*/
+
+/* Waits until the monotonic clock reads deadline ns, sleeping for
+   most of the wait and spinning for the rest. */
+static void Replay_waitUntil(size_t deadline) {
+   struct timespec pause;
+   size_t now;
+
+   while((now = Bench_now()) < deadline) {
+      if(deadline - now > SPIN_NS) {
+         pause.tv_sec = (time_t) ((deadline - now - SPIN_NS)
+                                  / 1000000000);
+         pause.tv_nsec = (long) ((deadline - now - SPIN_NS)
+                                 % 1000000000);
+         (void) nanosleep(&pause, NULL);
+      }
+   }
+}
+
+/* Makes the call that record describes, and returns its result in the
+   form that the trace records it in (see trace.h). */
+static int Replay_call(const struct Trace_record *record) {
+   boolean isFile;
+   size_t length;
+   char *string;
+   int result;
+
+   assert(record != NULL);
+
+   switch(record->op) {
+      case FT_OP_INSERT_DIR:
+         return FT_insertDir(record->path);
+      case FT_OP_CONTAINS_DIR:
+         return FT_containsDir(record->path);
+      case FT_OP_RM_DIR:
+         return FT_rmDir(record->path);
+      case FT_OP_INSERT_FILE:
+         return FT_insertFile(record->path, replayContents,
+                              record->length);
+      case FT_OP_CONTAINS_FILE:
+         return FT_containsFile(record->path);
+      case FT_OP_RM_FILE:
+         return FT_rmFile(record->path);
+      case FT_OP_GET_FILE_CONTENTS:
+         return FT_getFileContents(record->path) != NULL ?
+            SUCCESS : NO_SUCH_PATH;
+      case FT_OP_REPLACE_FILE_CONTENTS:
+         return FT_replaceFileContents(record->path, replayContents,
+                                       record->length) != NULL ?
+            SUCCESS : NO_SUCH_PATH;
+      case FT_OP_STAT:
+         return FT_stat(record->path, &isFile, &length);
+      case FT_OP_INIT:
+         return FT_init();
+      case FT_OP_DESTROY:
+         return FT_destroy();
+      case FT_OP_ENSURE_DIR:
+         return FT_ensureDir(record->path);
+      case FT_OP_UPSERT_FILE:
+         return FT_upsertFile(record->path, replayContents,
+                              record->length, NULL);
+      default:
+         string = FT_toString();
+         result = string != NULL ? SUCCESS : INITIALIZATION_ERROR;
+         free(string);
+         return result;
+   }
+}
+
+/* Replays every call in trace on a tree that uses the engine named
+   engine, as fast as possible or, if isTimed, at the times that they
+   were recorded, and prints the throughput and latency of each entry
+   point and of all calls together, and the number of calls whose
+   result differed from the recorded one. */
+static void Replay_run(Trace_T trace, const char *engine,
+                       boolean isTimed) {
+   size_t *latencies[FT_NUM_OPS];
+   size_t counts[FT_NUM_OPS];
+   size_t totals[FT_NUM_OPS];
+   size_t *allLatencies;
+   size_t allTotal = 0;
+   size_t mismatches = 0;
+   const struct Trace_record *record;
+   size_t length = Trace_getLength(trace);
+   size_t start;
+   size_t begin;
+   size_t elapsed;
+   size_t i;
+   int op;
+
+   if(FT_setEngine(engine) != SUCCESS)
+      fprintf(stderr, "ft_replay: cannot switch to engine %s\n",
+              engine);
+   Bench_beginGroup(engine, 0, 1);
+
+   for(op = 0; op < FT_NUM_OPS; op++)
+      counts[op] = totals[op] = 0;
+   for(i = 0; i < length; i++)
+      counts[Trace_get(trace, i)->op]++;
+   for(op = 0; op < FT_NUM_OPS; op++) {
+      latencies[op] = Bench_newSizes(counts[op] + 1);
+      counts[op] = 0;
+   }
+   allLatencies = Bench_newSizes(length + 1);
+
+   /* a trace started on a live tree begins without its FT_init */
+   if(length == 0 || Trace_get(trace, 0)->op != FT_OP_INIT)
+      (void) FT_init();
+
+   begin = Bench_now();
+   for(i = 0; i < length; i++) {
+      record = Trace_get(trace, i);
+      if(isTimed)
+         Replay_waitUntil(begin + record->timeNs);
+      start = Bench_now();
+      if(Replay_call(record) != record->result)
+         mismatches++;
+      elapsed = Bench_now() - start;
+      latencies[record->op][counts[record->op]++] = elapsed;
+      totals[record->op] += elapsed;
+      allLatencies[i] = elapsed;
+      allTotal += elapsed;
+   }
+   (void) FT_destroy();
+
+   Bench_printHeader("operation");
+   for(op = 0; op < FT_NUM_OPS; op++) {
+      Bench_report(opNames[op], latencies[op], counts[op], totals[op]);
+      free(latencies[op]);
+   }
+   Bench_report("all", allLatencies, length, allTotal);
+   free(allLatencies);
+   if(isTimed)
+      printf("wall time: %.3f s (recorded %.3f s)\n",
+             (double) (Bench_now() - begin) / 1e9,
+             length == 0 ? 0.0 :
+             (double) Trace_get(trace, length - 1)->timeNs / 1e9);
+   printf("mismatched results: %lu\n", (unsigned long) mismatches);
+}
+
+/* Prints how to invoke the program to stderr. */
+static void Replay_usage(const char *program) {
+   fprintf(stderr,
+      "usage: %s [-e engine[,engine...]|all] [-t] trace\n"
+      "  -t  replay at the recorded timing instead of at full speed\n"
+      "engines: sorted (default), hash, trie, all\n", program);
+}
+
+/* Splits the -e argument text, a comma-separated list of engine
+   names or "all", into names, storing the number of engines in
+   *pNumEngines. Returns TRUE if every engine exists, and FALSE
+   otherwise. */
+static boolean Replay_parseEngines(char *text, const char **names,
+                                   size_t *pNumEngines) {
+   char *name;
+
+   *pNumEngines = 0;
+   if(!strcmp(text, "all")) {
+      while(*pNumEngines < MAX_ENGINES &&
+            (names[*pNumEngines] = FT_getEngineName(*pNumEngines))
+               != NULL)
+         (*pNumEngines)++;
+      return TRUE;
+   }
+
+   for(name = strtok(text, ","); name != NULL;
+       name = strtok(NULL, ",")) {
+      if(*pNumEngines == MAX_ENGINES || FT_setEngine(name) != SUCCESS)
+         return FALSE;
+      names[(*pNumEngines)++] = name;
+   }
+   return *pNumEngines > 0;
+}
+
+/* Replays the trace named on the command line (see Replay_usage),
+   which FT_startTrace recorded, once per selected engine, and prints
+   the throughput and latency percentiles of each. Returns 0, or 1 if
+   the command line is invalid or the trace cannot be loaded. */
+int main(int argc, char *argv[]) {
+   const char *engines[MAX_ENGINES];
+   size_t numEngines = 1;
+   boolean isTimed = FALSE;
+   Trace_T trace;
+   size_t e;
+   int option;
+
+   engines[0] = FT_getEngineName(0);
+
+   while((option = getopt(argc, argv, "e:t")) != -1) {
+      switch(option) {
+         case 't': isTimed = TRUE; break;
+         case 'e':
+            if(!Replay_parseEngines(optarg, engines, &numEngines)) {
+               Replay_usage(argv[0]);
+               return 1;
+            }
+            break;
+         default:
+            Replay_usage(argv[0]);
+            return 1;
+      }
+   }
+   if(optind != argc - 1) {
+      Replay_usage(argv[0]);
+      return 1;
+   }
+
+   trace = Trace_load(argv[optind]);
+   if(trace == NULL)
+      return 1;
+   printf("trace: %lu calls\n", (unsigned long) Trace_getLength(trace));
+
+   for(e = 0; e < numEngines; e++)
+      Replay_run(trace, engines[e], isTimed);
+
+   Trace_free(trace);
+   return 0;
+}
@@ -0,0 +1,144 @@
+/*--------------------------------------------------------------------*/
+/* handle.c                                                           */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "handle.h"
+#include "stats.h"
+
+/* The number of slots in a chunk of the table, and the most chunks
+   the table has, which bounds the slots at 16M. */
+enum { CHUNK_SLOTS = 4096 };
+enum { MAX_CHUNKS = 4096 };
+
+/* One slot of the table. */
+struct slot {
+   /* the Node that the slot was given out for, or NULL if it is free */
+   Node n;
+   /* the number of times the slot has been released */
+   unsigned int generation;
+   /* the next free slot plus one, or 0, while the slot is free */
+   unsigned int nextFree;
+};
+
+/* The chunks of the table, of which the first ones are allocated. */
+static struct slot* chunks[MAX_CHUNKS];
+
+/* The number of slots that have ever been given out. It is raised
+   with a release store only once the slot's chunk is allocated, so
+   that Handle_get, which loads it with acquire ordering, sees the
+   chunk of every slot below it. */
+static unsigned int numSlots;
+
+/* The most recently released slot plus one, or 0 if none is free. */
+static unsigned int firstFree;
+
+/* Serializes the changes to the table. */
+static pthread_mutex_t handleLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* Returns the slot with index slotID, which must have been given
+   out. */
+static struct slot* Handle_slotAt(unsigned int slotID) {
+   return &chunks[slotID / CHUNK_SLOTS][slotID % CHUNK_SLOTS];
+}
+
+/* Returns the index of a slot to give out, taking it off the free list
+   or from the end of the table, or numSlots if every slot is taken or
+   there is not enough memory for a new chunk. Must be called with
+   handleLock held. */
+static unsigned int Handle_take(void) {
+   unsigned int slotID;
+
+   if(firstFree != 0) {
+      slotID = firstFree - 1;
+      firstFree = Handle_slotAt(slotID)->nextFree;
+      return slotID;
+   }
+
+   if(numSlots == (unsigned int) CHUNK_SLOTS * MAX_CHUNKS)
+      return numSlots;
+   if(numSlots % CHUNK_SLOTS == 0) {
+      /* calloc starts every generation of the chunk at 0 */
+      chunks[numSlots / CHUNK_SLOTS] =
+         calloc(CHUNK_SLOTS, sizeof(struct slot));
+      if(chunks[numSlots / CHUNK_SLOTS] == NULL)
+         return numSlots;
+      STATS_ADD(mallocs[FT_SUB_FT], 1);
+   }
+   __atomic_store_n(&numSlots, numSlots + 1, __ATOMIC_RELEASE);
+   return numSlots - 1;
+}
+
+/* see handle.h for specification */
+int Handle_open(Node n, struct FT_handle* pHandle) {
+   struct slot* s;
+   unsigned int slotID;
+
+   assert(n != NULL);
+   assert(pHandle != NULL);
+
+   (void) pthread_mutex_lock(&handleLock);
+   if(Node_getHandle(n) != 0)
+      slotID = Node_getHandle(n) - 1;
+   else {
+      slotID = Handle_take();
+      if(slotID == numSlots) {
+         (void) pthread_mutex_unlock(&handleLock);
+         return MEMORY_ERROR;
+      }
+      __atomic_store_n(&Handle_slotAt(slotID)->n, n, __ATOMIC_RELEASE);
+      Node_setHandle(n, slotID + 1);
+   }
+   s = Handle_slotAt(slotID);
+   pHandle->slot = slotID;
+   pHandle->generation = s->generation;
+   (void) pthread_mutex_unlock(&handleLock);
+
+   return SUCCESS;
+}
+
+/* see handle.h for specification */
+Node Handle_get(struct FT_handle handle) {
+   struct slot* s;
+   Node n;
+
+   if(handle.slot >= __atomic_load_n(&numSlots, __ATOMIC_ACQUIRE))
+      return NULL;
+
+   /* n is loaded before generation, so a generation that still
+      matches shows that n was stored for this handle's generation */
+   s = Handle_slotAt(handle.slot);
+   n = __atomic_load_n(&s->n, __ATOMIC_ACQUIRE);
+   if(n == NULL ||
+      __atomic_load_n(&s->generation, __ATOMIC_ACQUIRE)
+      != handle.generation)
+      return NULL;
+   return n;
+}
+
+/* see handle.h for specification */
+void Handle_close(Node n) {
+   struct slot* s;
+   unsigned int slotID;
+
+   assert(n != NULL);
+
+   if(Node_getHandle(n) == 0)
+      return;
+
+   (void) pthread_mutex_lock(&handleLock);
+   slotID = Node_getHandle(n) - 1;
+   s = Handle_slotAt(slotID);
+   __atomic_store_n(&s->n, NULL, __ATOMIC_RELEASE);
+   __atomic_store_n(&s->generation, s->generation + 1,
+                    __ATOMIC_RELEASE);
+   s->nextFree = firstFree;
+   firstFree = slotID + 1;
+   Node_setHandle(n, 0);
+   (void) pthread_mutex_unlock(&handleLock);
+}
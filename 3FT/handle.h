@@ -0,0 +1,48 @@
+/*--------------------------------------------------------------------*/
+/* handle.h                                                           */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef HANDLE_INCLUDED
+#define HANDLE_INCLUDED
+
+#include "ft.h"
+#include "node.h"
+
+/*
+   The handle module keeps the table of slots that FT handles refer
+   to. Each slot holds the Node it was given out for, if any, and a
+   generation that goes up every time the slot is released, so that a
+   handle kept past the removal of its Node, or past FT_close, no
+   longer matches its slot even after the slot is given out again. A
+   Node has at most one slot, which Node_destroy releases.
+
+   Slots are stored in chunks that never move once allocated, and
+   Handle_open and Handle_close take a lock between them. Handle_get
+   takes none, so that it may run while they do: they publish a new
+   chunk before the count of slots that covers it, and store the Node
+   and generation of a slot atomically, which Handle_get loads
+   atomically in turn. Generations outlive the tree, so that handles
+   from before an FT_destroy stay stale in the trees that follow it.
+*/
+
+/*
+  Stores in *pHandle a handle to n, giving n a slot if it has none yet.
+  Returns SUCCESS, or MEMORY_ERROR if there is not enough memory for
+  the slot or every slot is taken.
+*/
+int Handle_open(Node n, struct FT_handle* pHandle);
+
+/*
+  Returns the Node that handle refers to, or NULL if its slot has been
+  released since it was given out or was never given out.
+*/
+Node Handle_get(struct FT_handle handle);
+
+/*
+  Releases the slot of n, if it has one, so that every handle to n
+  becomes stale.
+*/
+void Handle_close(Node n);
+
+#endif
@@ -8,35 +8,226 @@
 #include <assert.h>
 #include "a4def.h"
 #include "node.h"
+#include "path.h"
+#include "stats.h"
+
+/* Starting at the parameter curr, follows name, the length bytes at
+   name (which need not be '\0'-terminated), as a path relative to
+   curr, as far down the file tree as it matches. Returns the farthest
+   matching Node, which is curr if not even the first component
+   matches. Every component but the last must name a directory, and
+   isFile is the type expected of the Node that the last one names, so
+   the engine looks among the subdirectories first on the way down and
+   among the children of type isFile at the end. name is split into
+   components PATH_PARTS at a time, in one scan each, and each level
+   looks its component up among the children by name with the current
+   engine. */
+Node HANDLER_descendRelative(const char* name, size_t length,
+                             Node curr, boolean isFile) {
+   struct Path_component parts[PATH_PARTS];
+   Node child;
+   const char* component = name;
+   const char* end = name + length;
+   size_t numParts;
+   size_t k;
+
+   assert(name != NULL);
+   assert(curr != NULL);
+
+   for(;;) {
+      numParts = Path_split(component, (size_t) (end - component),
+                            parts, PATH_PARTS);
+      for(k = 0; k < numParts; k++) {
+         child = Node_findChild(curr,
+                                parts[k].name + parts[k].length == end
+                                   ? isFile : FALSE,
+                                parts[k].name, parts[k].length);
+         if(child == NULL)
+            return curr;
+         STATS_ADD(nodesVisited, 1);
+         curr = child;
+      }
+      component = parts[numParts - 1].name + parts[numParts - 1].length;
+      if(component == end)
+         return curr;
+      component++;
+   }
+}
+
+/* Starting at the parameter curr, whose path must be the first
+   Node_getPathLength(curr) bytes of path and end at a component of
+   it, follows the rest of path, the length bytes at path (which need
+   not be '\0'-terminated), as far down the file tree as it matches,
+   with HANDLER_descendRelative. Returns the farthest matching Node,
+   which is curr if not even the next component matches. */
+Node HANDLER_descendFrom(const char* path, size_t length, Node curr,
+                         boolean isFile) {
+   const char* rest;
+
+   assert(path != NULL);
+   assert(curr != NULL);
+   assert(Node_getPathLength(curr) <= length);
+
+   rest = path + Node_getPathLength(curr);
+   if(rest == path + length)
+      return curr;
+   return HANDLER_descendRelative(rest + 1,
+                                  (size_t) (path + length - rest - 1),
+                                  curr, isFile);
+}
 
 /* Starting at the parameter curr, traverses as far down the file tree
-   as possible while still matching the path parameter. Returns a
+   as possible while still matching the path parameter, the length
+   bytes at path (which need not be '\0'-terminated). Returns a
    pointer to the farthest matching Node down that path, or NULL if
-   there is no node in curr's hierarchy that matches a prefix of path */
-Node HANDLER_traversePathFrom(char* path, Node curr) {
-   Node found;
-   size_t i;
-   char* currPath;
+   there is no node in curr's hierarchy that matches a prefix of path.
+   Checks that curr's own path matches and then descends from it with
+   HANDLER_descendFrom, isFile being the type expected of the Node of
+   the whole path. */
+Node HANDLER_traversePathFrom(const char* path, size_t length,
+                              Node curr, boolean isFile) {
+   size_t currLength;
+
+   assert(path != NULL);
 
    if(curr == NULL)
       return NULL;
+   STATS_ADD(nodesVisited, 1);
 
-   currPath = (char*)Node_getPath(curr);
-   if(!strcmp(path, currPath))
-      return curr;
+   currLength = Node_getPathLength(curr);
+   if(length < currLength ||
+      Path_compare(path, currLength, Node_getPath(curr),
+                   currLength) != 0 ||
+      (length != currLength && path[currLength] != '/'))
+      return NULL;
 
-   else if(!strncmp(path, currPath,
-                    strlen(currPath))) {
-      if(Node_isFile(curr))
-         return curr;
-      for(i = 0; i < Node_getNumChildren(curr); i++) {
-         found = HANDLER_traversePathFrom(path, Node_getChild(curr,i));
-         if(found != NULL)
-            return found;
+   return HANDLER_descendFrom(path, length, curr, isFile);
+}
+
+
+/* The number of paths that HANDLER_traverseMany resolves at once. */
+enum { HANDLER_GROUP = 16 };
+
+/* One lookup in flight in HANDLER_traverseMany. */
+struct lookup {
+   /* the identifier of its path among those of the batch */
+   size_t pathID;
+   /* the Node it has reached, whose path is a prefix of its path */
+   Node curr;
+   /* the '/' before the next component of the path, or its end */
+   const char* next;
+   /* the end of the path */
+   const char* end;
+   /* the next component, while a level is in progress */
+   const char* name;
+   size_t length;
+   /* the type expected of the child that the next component names */
+   boolean isFile;
+};
+
+/* Starts lookup l of path, which has identifier pathID, from curr,
+   checking that curr's own path matches as HANDLER_traversePathFrom
+   does. Returns TRUE if l must descend, or FALSE if it is already
+   resolved, to l->curr. */
+static boolean HANDLER_start(struct lookup* l,
+                             const struct Path_component* path,
+                             size_t pathID, Node curr) {
+   size_t currLength;
+
+   l->pathID = pathID;
+   l->curr = NULL;
+   if(curr == NULL)
+      return FALSE;
+   STATS_ADD(nodesVisited, 1);
+
+   currLength = Node_getPathLength(curr);
+   if(path->length < currLength ||
+      Path_compare(path->name, currLength, Node_getPath(curr),
+                   currLength) != 0 ||
+      (path->length != currLength && path->name[currLength] != '/'))
+      return FALSE;
+
+   l->curr = curr;
+   l->next = path->name + currLength;
+   l->end = path->name + path->length;
+   return l->next != l->end;
+}
+
+/* Fills group, which has *pActive lookups in flight, with lookups of
+   the next of the n paths, numbered from *pStarted, that must descend
+   from curr, storing the Node of each path that is resolved at once
+   in found. */
+static void HANDLER_fill(struct lookup group[], size_t* pActive,
+                         const struct Path_component paths[], size_t n,
+                         size_t* pStarted, Node curr, Node found[]) {
+   struct lookup* l;
+   size_t pathID;
+
+   while(*pActive < HANDLER_GROUP && *pStarted < n) {
+      pathID = (*pStarted)++;
+      l = &group[*pActive];
+      if(HANDLER_start(l, &paths[pathID], pathID, curr))
+         (*pActive)++;
+      else
+         found[pathID] = l->curr;
+   }
+}
+
+/* Resolves each of the n paths in paths from curr, as
+   HANDLER_traversePathFrom does, and stores the Node it gives for
+   paths[i] in found[i]. Keeps HANDLER_GROUP lookups in flight and
+   takes them all down one level per step, in three passes: the first
+   asks for the children header of each one's Node, the second for the
+   first keys under it, and the third searches them and asks for the
+   child found, so that by the time a pass reads what the pass before
+   it asked for, the rest of the group has given it time to load. Each
+   lookup that is resolved makes way for the next path. */
+void HANDLER_traverseMany(const struct Path_component paths[],
+                          size_t n, Node curr, boolean isFile,
+                          Node found[]) {
+   struct lookup group[HANDLER_GROUP];
+   struct lookup* l;
+   Node child;
+   size_t active = 0;
+   size_t started = 0;
+   size_t g;
+
+   assert(paths != NULL || n == 0);
+   assert(found != NULL || n == 0);
+
+   HANDLER_fill(group, &active, paths, n, &started, curr, found);
+   while(active != 0) {
+      for(g = 0; g < active; g++) {
+         l = &group[g];
+         l->name = l->next + 1;
+         l->length = Path_findSlash(l->name,
+                                    (size_t) (l->end - l->name));
+         l->isFile = l->name + l->length == l->end ? isFile : FALSE;
+         Node_prefetchChildren(l->curr, l->isFile);
       }
-      return curr;
+
+      for(g = 0; g < active; g++)
+         Node_prefetchSearch(group[g].curr, group[g].isFile);
+
+      for(g = 0; g < active; ) {
+         l = &group[g];
+         child = Node_findChild(l->curr, l->isFile, l->name, l->length);
+         if(child != NULL) {
+            STATS_ADD(nodesVisited, 1);
+            Node_prefetch(child);
+            l->curr = child;
+            l->next = l->name + l->length;
+            if(l->next != l->end) {
+               g++;
+               continue;
+            }
+         }
+         found[l->pathID] = l->curr;
+         *l = group[--active];
+      }
+
+      HANDLER_fill(group, &active, paths, n, &started, curr, found);
    }
-   return NULL;
 }
 
 
@@ -66,11 +257,21 @@ void HANDLER_strlenAccumulate(char* str, size_t* pAcc) {
 }
 
 /* Alternate version of strcat that inverts the typical argument
-   order, appending str onto acc, and also always adds a newline at
-   the end of the concatenated string. */
-void HANDLER_strcatAccumulate(char* str, char* acc) {
-   assert(acc != NULL);
+   order, appending str at *pEnd, the '\0' that ends the string being
+   accumulated, and also always adds a newline at the end of the
+   concatenated string. Advances *pEnd to the new end, so that each
+   append costs the length of str rather than of the whole string. */
+void HANDLER_strcatAccumulate(char* str, char** pEnd) {
+   size_t length;
 
-   if(str != NULL)
-      strcat(acc, str); strcat(acc, "\n");
+   assert(pEnd != NULL);
+   assert(*pEnd != NULL);
+
+   if(str != NULL) {
+      length = strlen(str);
+      memcpy(*pEnd, str, length);
+      *pEnd += length;
+      *(*pEnd)++ = '\n';
+      **pEnd = '\0';
+   }
 }
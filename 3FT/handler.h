@@ -9,12 +9,55 @@
 #include <stddef.h>
 #include "a4def.h"
 #include "node.h"
+#include "path.h"
+
+/* Starting at the parameter curr, follows name, the length bytes at
+   name (which need not be '\0'-terminated), as a path relative to
+   curr, as far down the file tree as it matches. Returns the farthest
+   matching Node, which is curr if not even the first component
+   matches. isFile is the type expected of the Node of the whole
+   name, as for HANDLER_traversePathFrom. The path of the Node
+   returned is curr's, then a '/', then as much of name as matched,
+   unless it is curr itself. */
+Node HANDLER_descendRelative(const char* name, size_t length,
+                             Node curr, boolean isFile);
+
+/* Starting at the parameter curr, whose path must be the first
+   Node_getPathLength(curr) bytes of path and end at a component of
+   it, follows the rest of path, the length bytes at path (which need
+   not be '\0'-terminated), as far down the file tree as it matches.
+   Returns the farthest matching Node, which is curr if not even the
+   next component matches. isFile is the type expected of the Node of
+   the whole path, as for HANDLER_traversePathFrom. Lets a caller
+   that has already resolved a prefix of path resume from there. */
+Node HANDLER_descendFrom(const char* path, size_t length, Node curr,
+                         boolean isFile);
 
 /* Starting at the parameter curr, traverses as far down the file tree
-   as possible while still matching the path parameter. Returns a
+   as possible while still matching the path parameter, the length
+   bytes at path (which need not be '\0'-terminated). Returns a
    pointer to the farthest matching Node down that path, or NULL if
-   there is no node in curr's hierarchy that matches a prefix of path */
-Node HANDLER_traversePathFrom(char* path, Node curr);
+   there is no node in curr's hierarchy that matches a prefix of path.
+   Every component but the last must name a directory, and isFile is
+   the type expected of the Node that the last one names, so the
+   engine looks among the subdirectories first on the way down and
+   among the children of type isFile at the end.
+   A prefix only matches whole components: "a/b" does not match
+   "a/bc". The path of the Node returned is always the first
+   Node_getPathLength bytes of path. */
+Node HANDLER_traversePathFrom(const char* path, size_t length,
+                              Node curr, boolean isFile);
+
+/* Resolves each of the n paths in paths from curr, as
+   HANDLER_traversePathFrom does, and stores the Node it gives for
+   paths[i] in found[i]. The lookups run interleaved, a level at a
+   time, each one asking for the memory its next step reads and then
+   making way for the others while that memory loads, so that the
+   misses of independent lookups overlap instead of following one
+   another. */
+void HANDLER_traverseMany(const struct Path_component paths[],
+                          size_t n, Node curr, boolean isFile,
+                          Node found[]);
 
 /* Given a prospective parent and child Node,
    adds child to parent's children list, if possible.
@@ -28,8 +71,10 @@ int HANDLER_linkParentToChild(Node parent, Node child);
 void HANDLER_strlenAccumulate(char* str, size_t* pAcc);
 
 /* Alternate version of strcat that inverts the typical argument
-   order, appending str onto acc, and also always adds a newline at
-   the end of the concatenated string. */
-void HANDLER_strcatAccumulate(char* str, char* acc);
+   order, appending str at *pEnd, the '\0' that ends the string being
+   accumulated, and also always adds a newline at the end of the
+   concatenated string. Advances *pEnd to the new end, so that each
+   append costs the length of str rather than of the whole string. */
+void HANDLER_strcatAccumulate(char* str, char** pEnd);
 
 #endif
\ No newline at end of file
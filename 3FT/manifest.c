@@ -0,0 +1,207 @@
+/*--------------------------------------------------------------------*/
+/* manifest.c                                                         */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "manifest.h"
+
+/* The number of bytes read from a manifest file at a time. */
+enum { READ_CHUNK = 1 << 16 };
+
+/* A manifest is the text of its file, split in place into entries
+   whose paths point into that text. */
+struct manifest {
+   /* the text of the file, with each path '\0'-terminated */
+   char* text;
+   /* the entries, in the order of their lines */
+   struct Manifest_entry* entries;
+   /* the number of entries */
+   size_t length;
+};
+
+/*
+   Returns the whole contents of stream in a new '\0'-terminated
+   buffer owned by the caller, or NULL if there is not enough memory
+   or a read error occurs.
+*/
+static char* Manifest_readAll(FILE* stream) {
+   char* text = NULL;
+   char* grown;
+   size_t used = 0;
+   size_t capacity = 0;
+   size_t got;
+
+   assert(stream != NULL);
+
+   do {
+      if(capacity - used < READ_CHUNK + 1) {
+         capacity = capacity * 2 + READ_CHUNK + 1;
+         grown = realloc(text, capacity);
+         if(grown == NULL) {
+            free(text);
+            return NULL;
+         }
+         text = grown;
+      }
+      got = fread(text + used, 1, READ_CHUNK, stream);
+      used += got;
+   } while(got == READ_CHUNK);
+
+   if(ferror(stream)) {
+      free(text);
+      return NULL;
+   }
+   text[used] = '\0';
+   return text;
+}
+
+/*
+   Parses the line at line, which ends at its '\n' or '\0', into
+   *pEntry, '\0'-terminating its path in place. Returns a pointer to
+   the start of the next line (or to the final '\0'), or NULL if the
+   line is malformed. Leaves pEntry->path NULL for a blank or comment
+   line.
+*/
+static char* Manifest_parseLine(char* line,
+                                struct Manifest_entry* pEntry) {
+   char* end = strchr(line, '\n');
+   char* next;
+   char* path;
+   char* number;
+
+   if(end == NULL)
+      next = end = line + strlen(line);
+   else
+      next = end + 1;
+   *end = '\0';
+
+   pEntry->path = NULL;
+   pEntry->length = 0;
+   if(*line == '\0' || *line == '#')
+      return next;
+   if(strchr("DFSMIRX", *line) == NULL || line[1] != ' ')
+      return NULL;
+   pEntry->kind = (enum Manifest_kind) *line;
+
+   path = line + 2;
+   number = strchr(path, ' ');
+   if(number != NULL)
+      *number++ = '\0';
+   if(*path == '\0')
+      return NULL;
+   pEntry->path = path;
+
+   if(pEntry->kind == MANIFEST_FILE ||
+      pEntry->kind == MANIFEST_INSERT_FILE) {
+      if(number == NULL || *number < '0' || *number > '9')
+         return NULL;
+      pEntry->length = strtoul(number, &number, 10);
+      if(*number != '\0')
+         return NULL;
+   }
+   else if(number != NULL)
+      return NULL;
+
+   return next;
+}
+
+/* see manifest.h for specification */
+Manifest_T Manifest_load(const char* filename) {
+   Manifest_T oManifest;
+   FILE* stream;
+   char* line;
+   size_t lines = 1;
+   size_t lineNumber;
+
+   assert(filename != NULL);
+
+   stream = fopen(filename, "r");
+   if(stream == NULL) {
+      fprintf(stderr, "%s: cannot open\n", filename);
+      return NULL;
+   }
+
+   oManifest = malloc(sizeof(struct manifest));
+   if(oManifest == NULL) {
+      (void) fclose(stream);
+      fprintf(stderr, "%s: out of memory\n", filename);
+      return NULL;
+   }
+   oManifest->text = Manifest_readAll(stream);
+   (void) fclose(stream);
+   if(oManifest->text == NULL) {
+      free(oManifest);
+      fprintf(stderr, "%s: cannot read\n", filename);
+      return NULL;
+   }
+
+   for(line = oManifest->text; *line != '\0'; line++)
+      if(*line == '\n')
+         lines++;
+   oManifest->entries = malloc(lines * sizeof(struct Manifest_entry));
+   if(oManifest->entries == NULL) {
+      free(oManifest->text);
+      free(oManifest);
+      fprintf(stderr, "%s: out of memory\n", filename);
+      return NULL;
+   }
+
+   oManifest->length = 0;
+   line = oManifest->text;
+   for(lineNumber = 1; *line != '\0'; lineNumber++) {
+      line = Manifest_parseLine(line,
+                                &oManifest->entries[oManifest->length]);
+      if(line == NULL) {
+         fprintf(stderr, "%s:%lu: malformed line\n", filename,
+                 (unsigned long) lineNumber);
+         Manifest_free(oManifest);
+         return NULL;
+      }
+      if(oManifest->entries[oManifest->length].path != NULL)
+         oManifest->length++;
+   }
+
+   return oManifest;
+}
+
+/* see manifest.h for specification */
+void Manifest_free(Manifest_T oManifest) {
+   assert(oManifest != NULL);
+
+   free(oManifest->entries);
+   free(oManifest->text);
+   free(oManifest);
+}
+
+/* see manifest.h for specification */
+size_t Manifest_getLength(Manifest_T oManifest) {
+   assert(oManifest != NULL);
+
+   return oManifest->length;
+}
+
+/* see manifest.h for specification */
+const struct Manifest_entry* Manifest_get(Manifest_T oManifest,
+                                          size_t entryID) {
+   assert(oManifest != NULL);
+   assert(entryID < oManifest->length);
+
+   return &oManifest->entries[entryID];
+}
+
+/* see manifest.h for specification */
+void Manifest_write(FILE* stream, enum Manifest_kind kind,
+                    const char* path, size_t length) {
+   assert(stream != NULL);
+   assert(path != NULL);
+
+   if(kind == MANIFEST_FILE || kind == MANIFEST_INSERT_FILE)
+      fprintf(stream, "%c %s %lu\n", (char) kind, path,
+              (unsigned long) length);
+   else
+      fprintf(stream, "%c %s\n", (char) kind, path);
+}
@@ -0,0 +1,81 @@
+/*--------------------------------------------------------------------*/
+/* manifest.h                                                         */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef MANIFEST_INCLUDED
+#define MANIFEST_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+   A manifest is a text file that lists a hierarchy or a sequence of
+   FT operations, one per line, as a kind letter, a space, a path and,
+   for the kinds that take one, a space and a length:
+
+      D path          a directory (inserted with FT_insertDir)
+      F path length   a file of length bytes (FT_insertFile)
+      S path          FT_stat of path
+      M path          FT_insertDir of path
+      I path length   FT_insertFile of path with length bytes
+      R path          FT_rmFile of path
+      X path          FT_rmDir of path
+
+   A hierarchy manifest uses D and F lines, parents before children;
+   an operation trace uses the others. Blank lines and lines starting
+   with '#' are ignored. Paths cannot contain spaces.
+*/
+
+/* The kinds of manifest line. */
+enum Manifest_kind { MANIFEST_DIR = 'D', MANIFEST_FILE = 'F',
+                     MANIFEST_STAT = 'S', MANIFEST_INSERT_DIR = 'M',
+                     MANIFEST_INSERT_FILE = 'I', MANIFEST_RM_FILE = 'R',
+                     MANIFEST_RM_DIR = 'X'
+};
+
+/* One line of a manifest. */
+struct Manifest_entry {
+   /* what the line lists or does */
+   enum Manifest_kind kind;
+   /* the path it applies to */
+   char* path;
+   /* the file length, or 0 for the kinds that take none */
+   size_t length;
+};
+
+/* A manifest loaded into memory. */
+typedef struct manifest* Manifest_T;
+
+/*
+  Reads the manifest in the file named filename into memory.
+  Returns it, or NULL (after writing why to stderr) if the file
+  cannot be read, a line is malformed, or there is not enough memory.
+*/
+Manifest_T Manifest_load(const char* filename);
+
+/*
+  Frees oManifest and every entry in it.
+*/
+void Manifest_free(Manifest_T oManifest);
+
+/*
+  Returns the number of entries in oManifest.
+*/
+size_t Manifest_getLength(Manifest_T oManifest);
+
+/*
+  Returns the entry of oManifest with index entryID, which must be
+  less than Manifest_getLength(oManifest).
+*/
+const struct Manifest_entry* Manifest_get(Manifest_T oManifest,
+                                          size_t entryID);
+
+/*
+  Writes one manifest line of kind kind for path, with length if kind
+  takes one, to stream.
+*/
+void Manifest_write(FILE* stream, enum Manifest_kind kind,
+                    const char* path, size_t length);
+
+#endif
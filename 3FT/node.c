@@ -8,8 +8,12 @@
 #include <assert.h>
 #include <stdio.h>
 
-#include "dynarray.h"
+#include "children.h"
 #include "node.h"
+#include "engine.h"
+#include "handle.h"
+#include "path.h"
+#include "stats.h"
 
 /*
    A node structure represents a directory in the directory tree
@@ -18,16 +22,37 @@ struct node {
    /* the type of node */
    boolean isFile;
 
+   /* the slot of the handle table that this node holds, plus one, or
+      0 if it holds none; it fits beside isFile */
+   unsigned int handle;
+
    /* the full path of this directory */
    char* path;
 
+   /* the length of path */
+   size_t pathLength;
+
+   /* the last component of path, which points into path */
+   const char* name;
+
+   /* the length of name */
+   size_t nameLength;
+
    /* the parent directory of this directory
       NULL for the root of the directory tree */
    Node parent;
 
+   /* the files among the children of this directory
+      stored in sorted order by pathname */
+   Children_T files;
+
    /* the subdirectories of this directory
       stored in sorted order by pathname */
-   DynArray_T children;
+   Children_T dirs;
+
+   /* the engine's index of children by name, or NULL if the engine
+      keeps none (or this node is a file) */
+   void* index;
 
    /* the contents of the file if this node is a file rather than a
       directory */
@@ -38,43 +63,111 @@ struct node {
 };
 
 
+/* The number of directories that the stack of Node_preOrder holds
+   before it first grows. */
+enum { FIRST_FRAMES = 64 };
+
+/* A directory on the stack of Node_preOrder, with the index of the
+   next of its children to visit. */
+struct frame {
+   Node n;
+   size_t next;
+};
+
+/* The engine that every node indexes its children with. */
+static const struct Engine* engine;
+
+
+/* see node.h for specification */
+void Node_setEngine(const struct Engine* newEngine) {
+   assert(newEngine != NULL);
+
+   engine = newEngine;
+}
+
+/*
+   Returns the current engine, making it the default engine if none
+   has been set.
+*/
+static const struct Engine* Node_getEngine(void) {
+   if(engine == NULL)
+      engine = Engine_get(0);
+   return engine;
+}
+
+/*
+  Returns the children of directory n of type isFile.
+*/
+static Children_T Node_childrenOf(Node n, boolean isFile) {
+   return isFile ? n->files : n->dirs;
+}
+
+/*
+  Returns the child of directory n with identifier childID, which
+  must be less than Node_getNumChildren(n): its files come first, then
+  its subdirectories, so that the identifiers follow Node_compare.
+*/
+static Node Node_childAt(Node n, size_t childID) {
+   size_t numFiles = Children_getLength(n->files);
+
+   if(childID < numFiles)
+      return Children_get(n->files, childID);
+   return Children_get(n->dirs, childID - numFiles);
+}
+
+/*
+  Returns the name within path of a Node with parent n: the part of
+  path after n's path and its slash, or all of path if n is NULL.
+*/
+static const char* Node_nameIn(Node n, const char* path) {
+   if(n == NULL)
+      return path;
+   return path + n->pathLength + 1;
+}
+
 /*
   returns a path with contents
   n->path/dir
+  where dir is the length bytes at dir,
   or NULL if there is an allocation error.
 
   Allocates memory for the returned string,
   which is then owened by the caller!
 */
-static char* Node_buildPath(Node n, const char* dir) {
+static char* Node_buildPath(Node n, const char* dir, size_t length) {
    char* path;
+   char* end;
+   size_t parentLength = 0;
 
    assert(dir != NULL);
 
-   if(n == NULL)
-      path = malloc(strlen(dir)+1);
-   else
-      path = malloc(strlen(n->path) + 1 + strlen(dir) + 1);
+   if(n != NULL)
+      parentLength = n->pathLength + 1;
 
+   path = malloc(parentLength + length + 1);
    if(path == NULL)
       return NULL;
-   *path = '\0';
+   STATS_ADD(mallocs[FT_SUB_NODE], 1);
 
+   end = path;
    if(n != NULL) {
-      strcpy(path, n->path);
-      strcat(path, "/");
+      memcpy(end, n->path, parentLength - 1);
+      end += parentLength - 1;
+      *end++ = '/';
    }
-   strcat(path, dir);
+   memcpy(end, dir, length);
+   end[length] = '\0';
 
    return path;
 }
 
 /* see node.h for specification */
-Node Node_createDir(const char* dir, Node parent){
-
+Node Node_create(const char* name, size_t length, Node parent,
+                 boolean isFile) {
    Node new;
+   boolean isFiltered;
 
-   assert(dir != NULL);
+   assert(name != NULL);
    if (parent != NULL) {
       assert(!parent->isFile);
    }
@@ -82,79 +175,169 @@ Node Node_createDir(const char* dir, Node parent){
    new = malloc(sizeof(struct node));
    if(new == NULL)
       return NULL;
+   STATS_ADD(mallocs[FT_SUB_NODE], 1);
 
-   new->path = Node_buildPath(parent, dir);
+   new->path = Node_buildPath(parent, name, length);
 
    if(new->path == NULL) {
       free(new);
+      STATS_ADD(frees[FT_SUB_NODE], 1);
       return NULL;
    }
 
+   new->pathLength = parent == NULL ? length
+                                    : parent->pathLength + 1 + length;
+   new->name = Node_nameIn(parent, new->path);
+   new->nameLength = length;
    new->parent = parent;
-   new->isFile = FALSE;
-   new->children = DynArray_new(0);
-   if(new->children == NULL) {
+   new->isFile = isFile;
+   new->handle = 0;
+   new->files = NULL;
+   new->dirs = NULL;
+   new->index = NULL;
+   new->fileContents = NULL;
+   new->length = 0;
+   if(isFile)
+      return new;
+
+   /* an engine with an index finds missing names without searching
+      the children, so only those without one filter them */
+   isFiltered = Node_getEngine()->newIndex == NULL;
+   new->files = Children_new(isFiltered);
+   new->dirs = new->files == NULL ? NULL : Children_new(isFiltered);
+   if(new->dirs == NULL) {
+      if(new->files != NULL)
+         Children_free(new->files);
       free(new->path);
       free(new);
+      STATS_ADD(frees[FT_SUB_NODE], 2);
       return NULL;
    }
 
-   new->fileContents = NULL;
-   new->length = 0;
+   if(Node_getEngine()->newIndex != NULL) {
+      new->index = engine->newIndex();
+      if(new->index == NULL) {
+         Children_free(new->files);
+         Children_free(new->dirs);
+         free(new->path);
+         free(new);
+         STATS_ADD(frees[FT_SUB_NODE], 2);
+         return NULL;
+      }
+   }
+
    return new;
 }
 
 /* see node.h for specification */
-Node Node_createFile(const char* dir, Node parent) {
-   Node new;
+Node Node_createDir(const char* dir, Node parent){
+   assert(dir != NULL);
 
+   return Node_create(dir, strlen(dir), parent, FALSE);
+}
+
+/* see node.h for specification */
+Node Node_createFile(const char* dir, Node parent) {
    assert(dir != NULL);
 
-   if(parent != NULL)
-      assert(!parent->isFile);
+   return Node_create(dir, strlen(dir), parent, TRUE);
+}
 
-   new = malloc(sizeof(struct node));
-   if(new == NULL)
-      return NULL;
+/* see node.h for specification */
+size_t Node_destroy(Node n) {
+   Children_T children;
+   size_t count = 0;
+   size_t length;
+   Node curr = n;
+   Node next;
 
-   new->path = Node_buildPath(parent, dir);
+   assert(n != NULL);
 
-   if(new->path == NULL) {
-      free(new);
-      return NULL;
-   }
+   /* Descends by detaching the last child of each directory from its
+      children arrays, and frees each Node once it has no children
+      left, climbing back up through its parent link. The tree itself
+      is the stack. */
+   while(curr != NULL) {
+      if(!curr->isFile) {
+         children = Children_getLength(curr->dirs) != 0 ? curr->dirs
+                                                        : curr->files;
+         if((length = Children_getLength(children)) != 0) {
+            curr = Children_removeAt(children, length - 1);
+            continue;
+         }
+      }
 
-   new->parent = parent;
-   new->isFile = TRUE;
-   new->children = NULL;
-   new->fileContents = NULL;
-   new->length = 0;
+      next = curr == n ? NULL : curr->parent;
+      Handle_close(curr);
+      if(!curr->isFile) {
+         Children_free(curr->files);
+         Children_free(curr->dirs);
+         if(curr->index != NULL)
+            engine->freeIndex(curr->index);
+      }
+      free(curr->path);
+      free(curr);
+      STATS_ADD(frees[FT_SUB_NODE], 2);
+      count++;
+      curr = next;
+   }
 
-   return new;
+   return count;
 }
 
 /* see node.h for specification */
-size_t Node_destroy(Node n) {
-   size_t i;
-   size_t count = 0;
-   Node c;
+int Node_preOrder(Node n, boolean (*visit)(Node m, void* extra),
+                  void* extra) {
+   struct frame* stack;
+   struct frame* grown;
+   size_t capacity = FIRST_FRAMES;
+   size_t depth = 0;
+   Node child;
 
    assert(n != NULL);
+   assert(visit != NULL);
+
+   if(!visit(n, extra) || n->isFile)
+      return SUCCESS;
 
-   if (!n->isFile) {
-      for(i = 0; i < DynArray_getLength(n->children); i++)
-      {
-         c = DynArray_get(n->children, i);
-         count += Node_destroy(c);
+   stack = malloc(capacity * sizeof(struct frame));
+   if(stack == NULL)
+      return MEMORY_ERROR;
+   STATS_ADD(mallocs[FT_SUB_NODE], 1);
+
+   stack[0].n = n;
+   stack[0].next = 0;
+   depth = 1;
+   while(depth != 0) {
+      if(stack[depth - 1].next ==
+         Node_getNumChildren(stack[depth - 1].n)) {
+         depth--;
+         continue;
+      }
+      child = Node_childAt(stack[depth - 1].n, stack[depth - 1].next++);
+      if(!visit(child, extra))
+         break;
+      if(child->isFile)
+         continue;
+
+      if(depth == capacity) {
+         grown = realloc(stack, 2 * capacity * sizeof(struct frame));
+         if(grown == NULL) {
+            free(stack);
+            STATS_ADD(frees[FT_SUB_NODE], 1);
+            return MEMORY_ERROR;
+         }
+         stack = grown;
+         capacity *= 2;
       }
-      DynArray_free(n->children);
+      stack[depth].n = child;
+      stack[depth].next = 0;
+      depth++;
    }
 
-   free(n->path);
-   free(n);
-   count++;
-
-   return count;
+   free(stack);
+   STATS_ADD(frees[FT_SUB_NODE], 1);
+   return SUCCESS;
 }
 
 const char* Node_getPath(Node n) {
@@ -163,18 +346,42 @@ const char* Node_getPath(Node n) {
    return n->path;
 }
 
+/* see node.h for specification */
+size_t Node_getPathLength(Node n) {
+   assert(n != NULL);
+
+   return n->pathLength;
+}
+
 /* see node.h for specification */
 int Node_compare(Node node1, Node node2) {
    assert(node1 != NULL);
    assert(node2 != NULL);
 
+   STATS_ADD(nodeCompares, 1);
+
    if (node1->isFile == node2->isFile)
-      return strcmp(node1->path, node2->path);
+      return Path_compare(node1->path, node1->pathLength, node2->path,
+                          node2->pathLength);
    if (node1->isFile && !node2->isFile)
       return -1;
    return 1;
 }
 
+/* see node.h for specification */
+const char* Node_getName(Node n) {
+   assert(n != NULL);
+
+   return n->name;
+}
+
+/* see node.h for specification */
+size_t Node_getNameLength(Node n) {
+   assert(n != NULL);
+
+   return n->nameLength;
+}
+
 /* see node.h for specification */
 boolean Node_isFile(Node n) {
    assert (n != NULL);
@@ -216,31 +423,85 @@ size_t Node_getNumChildren(Node n) {
    if (n->isFile)
       return 0;
    else
-      return DynArray_getLength(n->children);
+      return Children_getLength(n->files) + Children_getLength(n->dirs);
 }
 
 /* see node.h for specification */
-int Node_hasChild(Node n, const char* path, size_t* childID) {
-   size_t index;
-   int result;
-   Node checker;
+Node Node_findChild(Node n, boolean isFile, const char* name,
+                    size_t length) {
+   assert(n != NULL);
+   assert(name != NULL);
+
+   if(n->isFile)
+      return NULL;
+
+   return Node_getEngine()->find(n, isFile, name, length);
+}
+
+/* see node.h for specification */
+Node Node_searchChild(Node n, boolean isFile, const char* name,
+                      size_t length) {
+   size_t childID;
 
    assert(n != NULL);
-   assert(path != NULL);
+   assert(name != NULL);
 
-   if (n->isFile)
-      return NOT_A_DIRECTORY;
+   if(n->isFile ||
+      !Children_mayContain(Node_childrenOf(n, isFile), name, length) ||
+      !Children_search(Node_childrenOf(n, isFile), name, length,
+                       &childID))
+      return NULL;
+   return Children_get(Node_childrenOf(n, isFile), childID);
+}
 
-   checker = Node_createDir(path, NULL);
-   if(checker == NULL)
-      return -1;
-   result = DynArray_bsearch(n->children, checker, &index,
-                    (int (*)(const void*, const void*)) Node_compare);
-   (void) Node_destroy(checker);
+/* see node.h for specification */
+void Node_prefetch(Node n) {
+   assert(n != NULL);
 
-   if(childID != NULL)
-      *childID = index;
-   return result;
+   /* a node spans two cache lines unless it is aligned to one */
+   __builtin_prefetch(n);
+   __builtin_prefetch((const char*) n + sizeof(struct node) - 1);
+}
+
+/* see node.h for specification */
+void Node_prefetchChildren(Node n, boolean isFile) {
+   assert(n != NULL);
+
+   if(n->isFile)
+      return;
+   if(n->index != NULL)
+      __builtin_prefetch(n->index);
+   else
+      __builtin_prefetch(Node_childrenOf(n, isFile));
+}
+
+/* see node.h for specification */
+void Node_prefetchSearch(Node n, boolean isFile) {
+   assert(n != NULL);
+
+   if(!n->isFile && n->index == NULL)
+      Children_prefetch(Node_childrenOf(n, isFile));
+}
+
+/* see node.h for specification */
+void* Node_getIndex(Node n) {
+   assert(n != NULL);
+
+   return n->index;
+}
+
+/* see node.h for specification */
+unsigned int Node_getHandle(Node n) {
+   assert(n != NULL);
+
+   return n->handle;
+}
+
+/* see node.h for specification */
+void Node_setHandle(Node n, unsigned int handle) {
+   assert(n != NULL);
+
+   n->handle = handle;
 }
 
 /* see node.h for specification */
@@ -250,8 +511,8 @@ Node Node_getChild(Node n, size_t childID) {
    if (n->isFile)
       return NULL;
 
-   if(DynArray_getLength(n->children) > childID)
-      return DynArray_get(n->children, childID);
+   if(Node_getNumChildren(n) > childID)
+      return Node_childAt(n, childID);
    else
       return NULL;
 }
@@ -265,7 +526,9 @@ Node Node_getParent(Node n) {
 
 /* see node.h for specification */
 int Node_linkChild(Node parent, Node child) {
+   Children_T siblings;
    size_t i;
+   size_t length;
    char* rest;
 
    assert(parent != NULL);
@@ -274,33 +537,40 @@ int Node_linkChild(Node parent, Node child) {
    /* Handle error cases */
    if(parent->isFile)
       return NOT_A_DIRECTORY;
-   if(Node_hasChild(parent, child->path, NULL))
+   if(Node_findChild(parent, child->isFile, child->name,
+                     child->nameLength) != NULL)
       return ALREADY_IN_TREE;
-   i = strlen(parent->path);
-   if(strncmp(child->path, parent->path, i))
+   i = parent->pathLength;
+   length = child->pathLength;
+   if(length <= i || Path_compare(child->path, i, parent->path, i) != 0)
       return PARENT_CHILD_ERROR;
    rest = child->path + i;
-   if(strlen(child->path) >= i && rest[0] != '/')
+   if(rest[0] != '/')
       return PARENT_CHILD_ERROR;
    rest++;
-   if(strstr(rest, "/") != NULL)
+   if(Path_findSlash(rest, length - i - 1) != length - i - 1)
       return PARENT_CHILD_ERROR;
 
-   child->parent = parent;
-
-   if(DynArray_bsearch(parent->children, child, &i,
-         (int (*)(const void*, const void*)) Node_compare) == 1)
+   siblings = Node_childrenOf(parent, child->isFile);
+   if(Children_search(siblings, child->name, child->nameLength, &i))
       return ALREADY_IN_TREE;
 
-   /* if no errors, add the child to the dynarray */
-   if(DynArray_addAt(parent->children, i, child) == TRUE)
-      return SUCCESS;
-   else
-      return PARENT_CHILD_ERROR;
+   /* if no errors, add the child to the children and the index */
+   if(!Children_insertAt(siblings, i, child))
+      return MEMORY_ERROR;
+   if(parent->index != NULL && !engine->insert(parent->index, child)) {
+      (void) Children_removeAt(siblings, i);
+      return MEMORY_ERROR;
+   }
+
+   /* only now that nothing can fail is child changed */
+   child->parent = parent;
+   return SUCCESS;
 }
 
 /* see node.h for specification */
 int Node_unlinkChild(Node parent, Node child) {
+   Children_T siblings;
    size_t i;
 
    assert(parent != NULL);
@@ -309,11 +579,14 @@ int Node_unlinkChild(Node parent, Node child) {
    if (parent->isFile)
       return NOT_A_DIRECTORY;
 
-   if(DynArray_bsearch(parent->children, child, &i,
-         (int (*)(const void*, const void*)) Node_compare) == 0)
+   siblings = Node_childrenOf(parent, child->isFile);
+   if(!Children_search(siblings, child->name, child->nameLength, &i) ||
+      Children_get(siblings, i) != child)
       return PARENT_CHILD_ERROR;
 
-   (void) DynArray_removeAt(parent->children, i);
+   (void) Children_removeAt(siblings, i);
+   if(parent->index != NULL)
+      engine->remove(parent->index, child);
    return SUCCESS;
 }
 
@@ -332,7 +605,7 @@ int Node_addChild(Node parent, const char* dir, boolean isFile) {
       new = Node_createDir(dir, parent);
 
    if(new == NULL)
-      return PARENT_CHILD_ERROR;
+      return MEMORY_ERROR;
 
    result = Node_linkChild(parent, new);
    if(result != SUCCESS)
@@ -342,15 +615,35 @@ int Node_addChild(Node parent, const char* dir, boolean isFile) {
 }
 
 
+/* see node.h for specification */
+void Node_addMemory(Node n, struct FT_memory* pMemory) {
+   assert(n != NULL);
+   assert(pMemory != NULL);
+
+   pMemory->nodes++;
+   pMemory->nodeBytes += sizeof(struct node);
+   pMemory->pathBytes += n->pathLength + 1;
+   pMemory->allocations += 2;
+
+   if(n->isFile)
+      pMemory->contentBytes += n->length;
+   else {
+      Children_addMemory(n->files, pMemory);
+      Children_addMemory(n->dirs, pMemory);
+      if(n->index != NULL)
+         engine->addMemory(n->index, pMemory);
+   }
+}
+
 /* see node.h for specification */
 char* Node_toString(Node n) {
    char* copyPath;
 
    assert(n != NULL);
 
-   copyPath = malloc(strlen(n->path)+1);
+   copyPath = malloc(n->pathLength + 1);
    if(copyPath == NULL)
       return NULL;
-   else
-      return strcpy(copyPath, n->path);
+   STATS_ADD(mallocs[FT_SUB_NODE], 1);
+   return memcpy(copyPath, n->path, n->pathLength + 1);
 }
@@ -8,6 +8,7 @@
 
 #include <stddef.h>
 #include "a4def.h"
+#include "ft.h"
 
 /*
    a Node is an object that contains a path payload and references to
@@ -15,6 +16,9 @@
 */
 typedef struct node* Node;
 
+/* The engine that finds children by name; see engine.h. */
+struct Engine;
+
 
 /*
    Given a parent Node and a directory string dir, returns a new
@@ -47,14 +51,38 @@ Node Node_createDir(const char* dir, Node parent);
 */
 Node Node_createFile(const char* dir, Node parent);
 
+/*
+   Returns a new Node as Node_createFile does if isFile is TRUE, or as
+   Node_createDir does otherwise, named by the length bytes at name
+   (which need not be '\0'-terminated), or NULL if any allocation
+   error occurs.
+*/
+Node Node_create(const char* name, size_t length, Node parent,
+                 boolean isFile);
+
 /*
   Destroys the entire hierarchy of Nodes rooted at n,
-  including n itself.
+  including n itself. Works at any depth without recursion and
+  without allocating memory, so it cannot fail. Every handle to a
+  Node destroyed becomes stale.
 
   Returns the number of Nodes destroyed.
 */
 size_t Node_destroy(Node n);
 
+/*
+  Calls visit(m, extra) on every Node m in the hierarchy rooted at n,
+  in pre-order (each directory before its children, and children in
+  the order of Node_getChild), stopping early as soon as visit returns
+  FALSE. Keeps its stack of directories on the heap, so it works at
+  any depth.
+
+  Returns SUCCESS, or MEMORY_ERROR if there is not enough memory for
+  the stack, in which case only some of the Nodes have been visited.
+*/
+int Node_preOrder(Node n, boolean (*visit)(Node m, void* extra),
+                  void* extra);
+
 
 /*
   Compares node1 and node2 based on their paths.
@@ -68,6 +96,21 @@ int Node_compare(Node node1, Node node2);
 */
 const char* Node_getPath(Node n);
 
+/*
+   Returns the length of Node n's path, without computing it.
+*/
+size_t Node_getPathLength(Node n);
+
+/*
+   Returns Node n's name: the last component of its path.
+*/
+const char* Node_getName(Node n);
+
+/*
+   Returns the length of Node n's name, without computing it.
+*/
+size_t Node_getNameLength(Node n);
+
 /*
    Returns Node n's type in boolean form.
 */
@@ -94,20 +137,76 @@ void* Node_setContents(Node n, void* newContents, size_t newLength);
 size_t Node_getNumChildren(Node n);
 
 /*
-   Returns 1 if n has a child directory with path,
-   0 if it does not have such a child (including
-   if it is a file), and -1 if there is an
-   allocation error during search.
+   Returns the child of n, of either type, named by the length bytes
+   at name (which need not be '\0'-terminated), or NULL if n has no
+   such child (including if n is a file). Uses the current engine,
+   which looks among the children of type isFile first: the type that
+   the caller expects the child to have.
+*/
+Node Node_findChild(Node n, boolean isFile, const char* name,
+                    size_t length);
+
+/*
+   Returns the child of type isFile of n named by the length bytes at
+   name (which need not be '\0'-terminated), or NULL if n has no such
+   child (including if n is a file), by searching n's sorted children
+   rather than with the current engine. A name that the children's
+   Bloom filter rules out is not searched for.
+*/
+Node Node_searchChild(Node n, boolean isFile, const char* name,
+                      size_t length);
+
+/*
+   Asks the processor to start loading Node n, without waiting for it,
+   so that a later call on n finds it in the cache.
+*/
+void Node_prefetch(Node n);
+
+/*
+   Asks the processor to start loading, without waiting for it, what
+   Node_findChild(n, isFile, ...) reads first after n itself: the
+   header of n's children of type isFile, or the current engine's
+   index. n should be in the cache already, as after Node_prefetch.
+*/
+void Node_prefetchChildren(Node n, boolean isFile);
 
-   If n does have such a child, and childID is not NULL, store the
-   child's identifier in *childID. If n does not have such a child,
-   store the identifier that such a child would have in *childID.
+/*
+   Asks the processor to start loading, without waiting for it, the
+   first keys that searching n's children of type isFile reads, after
+   Node_prefetchChildren has loaded their header. Does nothing for an
+   engine with an index, whose first probe depends on the name.
 */
-int Node_hasChild(Node n, const char* path, size_t* childID);
+void Node_prefetchSearch(Node n, boolean isFile);
+
+/*
+   Returns the index that the current engine keeps of directory n's
+   children, or NULL if the engine keeps none.
+*/
+void* Node_getIndex(Node n);
+
+/*
+   Returns the slot of the handle table that n holds, plus one, or 0 if
+   it holds none.
+*/
+unsigned int Node_getHandle(Node n);
+
+/*
+   Records that n holds the slot of the handle table handle - 1, or
+   none if handle is 0. Only the handle module calls this.
+*/
+void Node_setHandle(Node n, unsigned int handle);
+
+/*
+   Makes engine the engine that Nodes created from now on index their
+   children with. Must only be called while no directory Nodes exist.
+*/
+void Node_setEngine(const struct Engine* engine);
 
 /*
    Returns the child Node of n with identifier childID, if one exists,
-   otherwise returns NULL.
+   otherwise returns NULL. The identifiers number n's files first and
+   then its subdirectories, each in order of name, which is the order
+   of Node_compare.
 */
 Node Node_getChild(Node n, size_t childID);
 
@@ -121,11 +220,12 @@ Node Node_getParent(Node n);
   This is not possible in the following cases:
   * child's path is not parent's path + / + directory,
     in which case returns PARENT_CHILD_ERROR
-  * parent already has a child with child's path,
+  * parent already has a child with child's name (of either type),
     in which case returns ALREADY_IN_TREE
   * parent is unable to allocate memory to store new child link,
     in which case returns MEMORY_ERROR
   * parent is a file type, in which case returns NOT_A_DIRECTORY
+  child is left unchanged in every one of these cases.
  */
 int Node_linkChild(Node parent, Node child);
 
@@ -155,6 +255,15 @@ int Node_unlinkChild(Node parent, Node child);
 */
 int Node_addChild(Node parent, const char* dir, boolean isFile);
 
+/*
+  Adds the heap memory that n itself occupies (its structure, its
+  path, and, for a directory, its children and index, but not
+  its descendants) to the matching members of *pMemory, and counts n in
+  pMemory->nodes. Leaves pMemory->totalBytes and
+  pMemory->bytesPerNode unchanged.
+*/
+void Node_addMemory(Node n, struct FT_memory* pMemory);
+
 /*
   Returns a string representation n, or NULL if there is an allocation
   error.
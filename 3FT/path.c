@@ -0,0 +1,231 @@
+/*--------------------------------------------------------------------*/
+/* path.c                                                             */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "path.h"
+
+/* Each vector path defines PATH_BLOCK, the number of bytes that it
+   scans at a time. */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PATH_BLOCK 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PATH_BLOCK 16
+#endif
+
+#ifdef PATH_BLOCK
+
+/* Returns a mask with bit i set where byte i of the PATH_BLOCK bytes
+   at s is a '/'. */
+static unsigned long Path_slashMask(const char* s) {
+#if defined(__AVX2__)
+   __m256i bytes = _mm256_loadu_si256((const __m256i*) s);
+   return (unsigned int) _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('/')));
+#else
+   __m128i bytes = _mm_loadu_si128((const __m128i*) s);
+   return (unsigned int) _mm_movemask_epi8(
+      _mm_cmpeq_epi8(bytes, _mm_set1_epi8('/')));
+#endif
+}
+
+#endif
+
+/* see path.h for specification */
+size_t Path_findSlash(const char* s, size_t length) {
+   size_t i = 0;
+#ifdef PATH_BLOCK
+   unsigned long mask;
+#endif
+
+   assert(s != NULL || length == 0);
+
+#ifdef PATH_BLOCK
+   for(; i + PATH_BLOCK <= length; i += PATH_BLOCK) {
+      mask = Path_slashMask(s + i);
+      if(mask != 0)
+         return i + (size_t) __builtin_ctzl(mask);
+   }
+#endif
+   for(; i < length; i++)
+      if(s[i] == '/')
+         return i;
+   return length;
+}
+
+/* see path.h for specification */
+size_t Path_split(const char* path, size_t length,
+                  struct Path_component parts[], size_t maxParts) {
+   size_t numParts = 0;
+   size_t start = 0;
+   size_t i = 0;
+#ifdef PATH_BLOCK
+   unsigned long mask;
+   size_t end;
+#endif
+
+   assert(path != NULL || length == 0);
+   assert(parts != NULL);
+   assert(maxParts != 0);
+
+#ifdef PATH_BLOCK
+   for(; i + PATH_BLOCK <= length; i += PATH_BLOCK)
+      for(mask = Path_slashMask(path + i); mask != 0;
+          mask &= mask - 1) {
+         end = i + (size_t) __builtin_ctzl(mask);
+         parts[numParts].name = path + start;
+         parts[numParts].length = end - start;
+         if(++numParts == maxParts)
+            return numParts;
+         start = end + 1;
+      }
+#endif
+   for(; i < length; i++)
+      if(path[i] == '/') {
+         parts[numParts].name = path + start;
+         parts[numParts].length = i - start;
+         if(++numParts == maxParts)
+            return numParts;
+         start = i + 1;
+      }
+   parts[numParts].name = path + start;
+   parts[numParts].length = length - start;
+   return numParts + 1;
+}
+
+/* see path.h for specification */
+int Path_compare(const char* a, size_t aLength, const char* b,
+                 size_t bLength) {
+   int result;
+
+   assert(a != NULL || aLength == 0);
+   assert(b != NULL || bLength == 0);
+
+   /* memcmp orders bytes as unsigned char, as strcmp does, and the C
+      library picks the widest vector loop that the machine running it
+      has, which a loop built for the compiler's target cannot */
+   result = memcmp(a, b, aLength < bLength ? aLength : bLength);
+   if(result != 0 || aLength == bLength)
+      return result;
+   return aLength < bLength ? -1 : 1;
+}
+
+/* The number of paths at or below which Path_sort finishes a part
+   by insertion. */
+enum { SORT_INSERT = 12 };
+
+/* Returns byte depth of the path p, as unsigned, or 0 past its end,
+   which orders a path before every longer one that it is a prefix
+   of: a path holds no '\0' of its own. */
+static unsigned int Path_byteAt(const struct Path_component* p,
+                                size_t depth) {
+   return depth < p->length ? (unsigned char) p->name[depth] : 0;
+}
+
+/* Sorts the n indices at order, which index paths that all share
+   their first depth bytes, by insertion. */
+static void Path_insertionSort(const struct Path_component paths[],
+                               size_t order[], size_t n,
+                               size_t depth) {
+   const struct Path_component* p;
+   size_t moving;
+   size_t i;
+   size_t j;
+
+   for(i = 1; i < n; i++) {
+      moving = order[i];
+      p = &paths[moving];
+      for(j = i; j > 0; j--) {
+         if(Path_compare(paths[order[j - 1]].name + depth,
+                         paths[order[j - 1]].length - depth,
+                         p->name + depth, p->length - depth) <= 0)
+            break;
+         order[j] = order[j - 1];
+      }
+      order[j] = moving;
+   }
+}
+
+/* Sorts the n indices at order, which index paths that all share
+   their first depth bytes. Splits them by byte depth into those
+   below, equal to and above a pivot byte, sorts the two smaller parts
+   recursively and goes on with the largest, one byte deeper if that
+   is the equal part, so that each recursion takes at most half of the
+   paths. */
+static void Path_sortFrom(const struct Path_component paths[],
+                          size_t order[], size_t n, size_t depth) {
+   size_t lo;
+   size_t hi;
+   size_t i;
+   size_t swap;
+   size_t sizes[3];
+   size_t largest;
+   unsigned int pivot;
+   unsigned int a;
+   unsigned int b;
+   unsigned int c;
+   unsigned int byte;
+
+   while(n > SORT_INSERT) {
+      /* the median of the first, middle and last bytes */
+      a = Path_byteAt(&paths[order[0]], depth);
+      b = Path_byteAt(&paths[order[n / 2]], depth);
+      c = Path_byteAt(&paths[order[n - 1]], depth);
+      pivot = a < b ? (b < c ? b : a < c ? c : a)
+                    : (a < c ? a : b < c ? c : b);
+
+      lo = 0;
+      i = 0;
+      hi = n;
+      while(i < hi) {
+         byte = Path_byteAt(&paths[order[i]], depth);
+         if(byte < pivot) {
+            swap = order[lo];
+            order[lo++] = order[i];
+            order[i++] = swap;
+         }
+         else if(byte > pivot) {
+            swap = order[--hi];
+            order[hi] = order[i];
+            order[i] = swap;
+         }
+         else
+            i++;
+      }
+
+      /* paths equal up to their end are sorted already */
+      sizes[0] = lo;
+      sizes[1] = pivot == 0 ? 0 : hi - lo;
+      sizes[2] = n - hi;
+      largest = sizes[0] >= sizes[1] && sizes[0] >= sizes[2] ? 0
+                : sizes[1] >= sizes[2] ? 1 : 2;
+      if(largest != 0)
+         Path_sortFrom(paths, order, sizes[0], depth);
+      if(largest != 1 && sizes[1] != 0)
+         Path_sortFrom(paths, order + lo, sizes[1], depth + 1);
+      if(largest != 2)
+         Path_sortFrom(paths, order + hi, sizes[2], depth);
+
+      if(largest == 1) {
+         order += lo;
+         depth++;
+      }
+      else if(largest == 2)
+         order += hi;
+      n = sizes[largest];
+   }
+   Path_insertionSort(paths, order, n, depth);
+}
+
+/* see path.h for specification */
+void Path_sort(const struct Path_component paths[], size_t order[],
+               size_t n) {
+   assert(paths != NULL || n == 0);
+   assert(order != NULL || n == 0);
+
+   Path_sortFrom(paths, order, n, 0);
+}
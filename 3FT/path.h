@@ -0,0 +1,68 @@
+/*--------------------------------------------------------------------*/
+/* path.h                                                             */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef PATH_INCLUDED
+#define PATH_INCLUDED
+
+#include <stddef.h>
+
+/*
+   The path module scans and compares the bytes of paths whose lengths
+   are known, so that a path is read once rather than by a series of
+   strlen, strchr and strncmp calls. Where the compiler targets AVX2 or
+   SSE2, each scan for '/' looks at 32 or 16 bytes at a time; elsewhere
+   it looks at one. Comparisons use memcmp, whose vector loop the C
+   library chooses for the machine at run time. Nothing reads past the
+   length given, so the bytes need not be '\0'-terminated.
+*/
+
+/* The number of components that callers split a path into at a time,
+   in an array on their stack. */
+enum { PATH_PARTS = 32 };
+
+/* One component of a path: the length bytes at name, which point into
+   the path and are not '\0'-terminated. */
+struct Path_component {
+   const char* name;
+   size_t length;
+};
+
+/*
+  Returns the offset of the first '/' in the length bytes at s, or
+  length if there is none.
+*/
+size_t Path_findSlash(const char* s, size_t length);
+
+/*
+  Splits the length bytes at path at every '/', in one scan, into the
+  components between them, which are empty where path starts or ends
+  with a '/' or has two in a row. Stores the components in parts, up
+  to maxParts of them, which must not be 0, and returns the number
+  stored. The scan stops at the '/' after the last component stored,
+  so the path goes on past it exactly when it does not end at
+  path + length.
+*/
+size_t Path_split(const char* path, size_t length,
+                  struct Path_component parts[], size_t maxParts);
+
+/*
+  Compares the aLength bytes at a with the bLength bytes at b in the
+  order of strcmp on them as strings, returning <0, 0, or >0.
+*/
+int Path_compare(const char* a, size_t aLength, const char* b,
+                 size_t bLength);
+
+/*
+  Sorts order, an array of n indices into paths, so that the paths
+  they index are in the order of Path_compare, ties in any order.
+  Sorts by one byte position at a time, three ways around a pivot
+  byte, so that the bytes that paths share at their start are read
+  once per pass rather than once per comparison. Never recurses
+  deeper than the logarithm of n.
+*/
+void Path_sort(const struct Path_component paths[], size_t order[],
+               size_t n);
+
+#endif
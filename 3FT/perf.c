@@ -0,0 +1,160 @@
+/*--------------------------------------------------------------------*/
+/* perf.c                                                             */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "perf.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* The names of the events, indexed by PERF_ value. */
+static const char *eventNames[PERF_NUM_EVENTS] = {
+   "cycles", "instructions", "l1dMisses", "llcMisses", "branchMisses"
+};
+
+/* The file descriptor of each event's counter, or -1 if it is not
+   open. */
+static int counters[PERF_NUM_EVENTS] = { -1, -1, -1, -1, -1 };
+
+/* see perf.h for specification */
+const char *Perf_getName(int event) {
+   assert(event >= 0 && event < PERF_NUM_EVENTS);
+
+   return eventNames[event];
+}
+
+/* see perf.h for specification */
+void Perf_close(void) {
+   int event;
+
+   for(event = 0; event < PERF_NUM_EVENTS; event++)
+      if(counters[event] != -1) {
+         (void) close(counters[event]);
+         counters[event] = -1;
+      }
+}
+
+#ifdef __linux__
+
+/* Opens a disabled counter of the calling thread for the event of
+   type type and configuration config. Returns its file descriptor, or
+   -1 with errno set. */
+static int Perf_openEvent(unsigned int type, unsigned long config) {
+   struct perf_event_attr attr;
+
+   memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = type;
+   attr.config = config;
+   attr.disabled = 1;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                      PERF_FORMAT_TOTAL_TIME_RUNNING;
+   return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* see perf.h for specification */
+size_t Perf_open(int *pError) {
+   static const unsigned int types[PERF_NUM_EVENTS] = {
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+   };
+   static const unsigned long configs[PERF_NUM_EVENTS] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_L1D |
+         PERF_COUNT_HW_CACHE_OP_READ << 8 |
+         PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES
+   };
+   size_t opened = 0;
+   int event;
+
+   assert(pError != NULL);
+
+   Perf_close();
+   *pError = 0;
+   for(event = 0; event < PERF_NUM_EVENTS; event++) {
+      counters[event] = Perf_openEvent(types[event], configs[event]);
+      if(counters[event] != -1)
+         opened++;
+      else if(*pError == 0)
+         *pError = errno;
+   }
+   return opened;
+}
+
+/* see perf.h for specification */
+void Perf_start(void) {
+   int event;
+
+   for(event = 0; event < PERF_NUM_EVENTS; event++)
+      if(counters[event] != -1) {
+         (void) ioctl(counters[event], PERF_EVENT_IOC_RESET, 0);
+         (void) ioctl(counters[event], PERF_EVENT_IOC_ENABLE, 0);
+      }
+}
+
+/* see perf.h for specification */
+boolean Perf_read(double counts[PERF_NUM_EVENTS]) {
+   /* the count, time enabled and time running, in ns */
+   __u64 values[3];
+   boolean isOpen = FALSE;
+   int event;
+
+   assert(counts != NULL);
+
+   for(event = 0; event < PERF_NUM_EVENTS; event++) {
+      counts[event] = -1;
+      if(counters[event] == -1)
+         continue;
+      isOpen = TRUE;
+      (void) ioctl(counters[event], PERF_EVENT_IOC_DISABLE, 0);
+      if(read(counters[event], values, sizeof(values))
+            != (ssize_t) sizeof(values) || values[2] == 0)
+         continue;
+      counts[event] = (double) values[0];
+      if(values[2] < values[1])
+         counts[event] *= (double) values[1] / (double) values[2];
+   }
+   return isOpen;
+}
+
+#else
+
+/* see perf.h for specification */
+size_t Perf_open(int *pError) {
+   assert(pError != NULL);
+
+   *pError = ENOSYS;
+   return 0;
+}
+
+/* see perf.h for specification */
+void Perf_start(void) {
+}
+
+/* see perf.h for specification */
+boolean Perf_read(double counts[PERF_NUM_EVENTS]) {
+   int event;
+
+   assert(counts != NULL);
+
+   for(event = 0; event < PERF_NUM_EVENTS; event++)
+      counts[event] = -1;
+   return FALSE;
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*--------------------------------------------------------------------*/
+/* perf.h                                                             */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef PERF_INCLUDED
+#define PERF_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+   The perf module counts hardware events of the calling thread, user
+   mode only, with the Linux perf_event_open interface. Each counter
+   is opened on its own, so a machine or virtual machine that lacks
+   some events still counts the rest; where perf_event_open is missing
+   or forbidden (see /proc/sys/kernel/perf_event_paranoid), none
+   open and the benchmarks run without them. When the kernel shares
+   the hardware counters among more events than fit, each count is
+   scaled up from the time that its counter actually ran.
+*/
+
+/* The events counted. */
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES,
+       PERF_LLC_MISSES, PERF_BRANCH_MISSES, PERF_NUM_EVENTS };
+
+/* Opens a counter for every event that the machine can count, and
+   returns the number opened. If that is 0, stores the errno of the
+   first failure in *pError. Opening again first closes the counters
+   already open. */
+size_t Perf_open(int *pError);
+
+/* Zeroes every open counter and starts it counting. */
+void Perf_start(void);
+
+/* Stops every open counter, and stores the count of each event since
+   Perf_start in counts, or -1 for the events that are not counted.
+   Returns TRUE, or FALSE if no counter is open. */
+boolean Perf_read(double counts[PERF_NUM_EVENTS]);
+
+/* Closes every open counter. */
+void Perf_close(void);
+
+/* Returns the name of event, a PERF_ value, in the form used as a
+   JSON member name, such as "llcMisses". */
+const char *Perf_getName(int event);
+
+#endif
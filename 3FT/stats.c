@@ -0,0 +1,380 @@
+/*--------------------------------------------------------------------*/
+/* stats.c                                                            */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "stats.h"
+
+/* The number of size_t counters in a struct FT_stats. */
+#define STATS_NUM_COUNTERS (sizeof(struct FT_stats) / sizeof(size_t))
+
+/* The number of size_t fields in a struct Stats_histogram. */
+#define STATS_HISTOGRAM_FIELDS \
+   (sizeof(struct Stats_histogram) / sizeof(size_t))
+
+/* The names of the FT entry points, indexed by enum FT_op. */
+static const char* const opNames[FT_NUM_OPS] = {
+   "FT_insertDir", "FT_containsDir", "FT_rmDir",
+   "FT_insertFile", "FT_containsFile", "FT_rmFile",
+   "FT_getFileContents", "FT_replaceFileContents",
+   "FT_stat", "FT_init", "FT_destroy", "FT_toString",
+   "FT_ensureDir", "FT_upsertFile", "FT_statMany",
+   "FT_statBatch", "FT_open", "FT_close", "FT_insertFileAt",
+   "FT_statAt", "FT_getFileContentsById", "FT_listAt"
+};
+
+/* The percentiles reported by Stats_dumpLatency. */
+static const double dumpQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+static const char* const dumpLabels[] = {
+   "p50", "p90", "p99", "p999"
+};
+enum { NUM_DUMP_QUANTILES = 4 };
+
+/* Returns the largest latency, in ns, counted by bucket. */
+static size_t Stats_bucketTop(size_t bucket) {
+   size_t exponent;
+   size_t sub;
+
+   assert(bucket < STATS_NUM_BUCKETS);
+
+   if(bucket < STATS_SUB_BUCKETS)
+      return bucket;
+
+   exponent = bucket / STATS_SUB_BUCKETS + STATS_SUB_BUCKET_BITS - 1;
+   sub = bucket % STATS_SUB_BUCKETS;
+   return ((STATS_SUB_BUCKETS + sub + 1)
+           << (exponent - STATS_SUB_BUCKET_BITS)) - 1;
+}
+
+#ifndef NSTATS
+
+/* Returns the index of the histogram bucket that counts latencyNs. */
+static size_t Stats_bucketOf(size_t latencyNs) {
+   size_t exponent = STATS_SUB_BUCKET_BITS;
+
+   if(latencyNs < STATS_SUB_BUCKETS)
+      return latencyNs;
+
+   while(exponent < STATS_MAX_EXPONENT &&
+         (latencyNs >> (exponent + 1)) != 0)
+      exponent++;
+   if((latencyNs >> (exponent + 1)) != 0)
+      return STATS_NUM_BUCKETS - 1;
+
+   /* Buckets 0..STATS_SUB_BUCKETS-1 hold exact values; each higher
+      power of two gets the next STATS_SUB_BUCKETS buckets. */
+   return (exponent - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKETS
+      + ((latencyNs >> (exponent - STATS_SUB_BUCKET_BITS))
+         & (STATS_SUB_BUCKETS - 1));
+}
+
+/* Adds every bucket and total in *pFrom, which its thread may be
+   adding to, to *pTo. */
+static void Stats_accumulateLatency(
+   struct Stats_histogram* pTo, struct Stats_histogram* pFrom) {
+   size_t b;
+   size_t maxNs;
+
+   assert(pTo != NULL);
+   assert(pFrom != NULL);
+
+   for(b = 0; b < STATS_NUM_BUCKETS; b++)
+      pTo->buckets[b] += __atomic_load_n(&pFrom->buckets[b],
+                                         __ATOMIC_RELAXED);
+   pTo->count += __atomic_load_n(&pFrom->count, __ATOMIC_RELAXED);
+   pTo->totalNs += __atomic_load_n(&pFrom->totalNs, __ATOMIC_RELAXED);
+   maxNs = __atomic_load_n(&pFrom->maxNs, __ATOMIC_RELAXED);
+   if(maxNs > pTo->maxNs)
+      pTo->maxNs = maxNs;
+}
+
+/* see stats.h */
+__thread struct Stats_local Stats_tls;
+
+/* The registered counters of every live thread. */
+static struct Stats_local* threads;
+
+/* The counters and latencies of threads that have exited. */
+static struct FT_stats retired;
+static struct Stats_histogram retiredLatency[FT_NUM_OPS];
+
+/* Guards threads and retired. */
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The key whose destructor retires a thread's counters on exit. */
+static pthread_key_t exitKey;
+static pthread_once_t exitKeyOnce = PTHREAD_ONCE_INIT;
+
+
+/* Adds every counter in *pFrom, which its thread may be adding to,
+   to the matching counter in *pTo. */
+static void Stats_accumulate(struct FT_stats* pTo,
+                             struct FT_stats* pFrom) {
+   size_t* to = (size_t*) pTo;
+   size_t* from = (size_t*) pFrom;
+   size_t i;
+
+   assert(pTo != NULL);
+   assert(pFrom != NULL);
+
+   for(i = 0; i < STATS_NUM_COUNTERS; i++)
+      to[i] += __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+}
+
+/* Sets each of the numCounters counters at counters, which their
+   thread may be adding to, to 0. */
+static void Stats_clear(size_t* counters, size_t numCounters) {
+   size_t i;
+
+   assert(counters != NULL);
+
+   for(i = 0; i < numCounters; i++)
+      __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+}
+
+/* Folds the exiting thread's counters, pvLocal, into retired and
+   removes them from the list of live threads. */
+static void Stats_retire(void* pvLocal) {
+   struct Stats_local* local = pvLocal;
+   struct Stats_local** link;
+   size_t op;
+
+   assert(local != NULL);
+
+   (void) pthread_mutex_lock(&statsLock);
+   Stats_accumulate(&retired, &local->stats);
+   for(op = 0; op < FT_NUM_OPS; op++)
+      Stats_accumulateLatency(&retiredLatency[op],
+                              &local->latency[op]);
+   for(link = &threads; *link != NULL; link = &(*link)->next)
+      if(*link == local) {
+         *link = local->next;
+         break;
+      }
+   (void) pthread_mutex_unlock(&statsLock);
+}
+
+/* Creates exitKey. */
+static void Stats_makeExitKey(void) {
+   (void) pthread_key_create(&exitKey, Stats_retire);
+}
+
+/* see stats.h for specification */
+int Stats_register(void) {
+   (void) pthread_once(&exitKeyOnce, Stats_makeExitKey);
+   (void) pthread_setspecific(exitKey, &Stats_tls);
+
+   (void) pthread_mutex_lock(&statsLock);
+   Stats_tls.next = threads;
+   threads = &Stats_tls;
+   Stats_tls.isRegistered = 1;
+   (void) pthread_mutex_unlock(&statsLock);
+
+   return 1;
+}
+
+/* see stats.h for specification */
+size_t Stats_now(void) {
+   struct timespec now;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+   return (size_t) now.tv_sec * 1000000000 + (size_t) now.tv_nsec;
+}
+
+/* see stats.h for specification */
+void Stats_recordLatency(enum FT_op op, size_t latencyNs) {
+   struct Stats_histogram* histogram = &Stats_tls.latency[op];
+
+   assert(op < FT_NUM_OPS);
+
+   STATS_BUMP(histogram->buckets[Stats_bucketOf(latencyNs)], 1);
+   STATS_BUMP(histogram->count, 1);
+   STATS_BUMP(histogram->totalNs, latencyNs);
+   if(latencyNs > __atomic_load_n(&histogram->maxNs, __ATOMIC_RELAXED))
+      __atomic_store_n(&histogram->maxNs, latencyNs, __ATOMIC_RELAXED);
+}
+
+/* see stats.h for specification */
+void Stats_read(struct FT_stats* pStats) {
+   struct Stats_local* local;
+
+   assert(pStats != NULL);
+
+   (void) pthread_mutex_lock(&statsLock);
+   *pStats = retired;
+   for(local = threads; local != NULL; local = local->next)
+      Stats_accumulate(pStats, &local->stats);
+   (void) pthread_mutex_unlock(&statsLock);
+}
+
+/* see stats.h for specification */
+void Stats_readLatency(enum FT_op op,
+                       struct Stats_histogram* pHistogram) {
+   struct Stats_local* local;
+
+   assert(op < FT_NUM_OPS);
+   assert(pHistogram != NULL);
+
+   (void) pthread_mutex_lock(&statsLock);
+   *pHistogram = retiredLatency[op];
+   for(local = threads; local != NULL; local = local->next)
+      Stats_accumulateLatency(pHistogram, &local->latency[op]);
+   (void) pthread_mutex_unlock(&statsLock);
+}
+
+/* see stats.h for specification */
+void Stats_reset(void) {
+   struct Stats_local* local;
+
+   (void) pthread_mutex_lock(&statsLock);
+   memset(&retired, 0, sizeof(retired));
+   memset(retiredLatency, 0, sizeof(retiredLatency));
+   for(local = threads; local != NULL; local = local->next) {
+      Stats_clear((size_t*) &local->stats, STATS_NUM_COUNTERS);
+      Stats_clear((size_t*) local->latency,
+                  FT_NUM_OPS * STATS_HISTOGRAM_FIELDS);
+   }
+   (void) pthread_mutex_unlock(&statsLock);
+}
+
+#else
+
+/* see stats.h for specification */
+void Stats_read(struct FT_stats* pStats) {
+   assert(pStats != NULL);
+
+   memset(pStats, 0, sizeof(*pStats));
+}
+
+/* see stats.h for specification */
+void Stats_readLatency(enum FT_op op,
+                       struct Stats_histogram* pHistogram) {
+   assert(op < FT_NUM_OPS);
+   assert(pHistogram != NULL);
+
+   (void) op;
+   memset(pHistogram, 0, sizeof(*pHistogram));
+}
+
+/* see stats.h for specification */
+void Stats_reset(void) {
+}
+
+#endif
+
+/* see stats.h for specification */
+size_t Stats_percentile(const struct Stats_histogram* pHistogram,
+                        double quantile) {
+   size_t rank;
+   size_t seen = 0;
+   size_t b;
+
+   assert(pHistogram != NULL);
+   assert(quantile >= 0 && quantile <= 1);
+
+   if(pHistogram->count == 0)
+      return 0;
+
+   /* the rank, counting from 1, of the latency at quantile */
+   rank = (size_t) (quantile * (double) pHistogram->count);
+   if(rank == 0 ||
+      (double) rank < quantile * (double) pHistogram->count)
+      rank++;
+
+   for(b = 0; b < STATS_NUM_BUCKETS; b++) {
+      seen += pHistogram->buckets[b];
+      if(seen >= rank)
+         break;
+   }
+
+   /* No bucket reaches past the largest latency recorded. */
+   if(b == STATS_NUM_BUCKETS || Stats_bucketTop(b) > pHistogram->maxNs)
+      return pHistogram->maxNs;
+   return Stats_bucketTop(b);
+}
+
+/* Writes the latencies in *pHistogram of the FT entry point named
+   name to stream as one line of text. */
+static void Stats_dumpText(FILE* stream, const char* name,
+                           const struct Stats_histogram* pHistogram) {
+   size_t q;
+
+   assert(stream != NULL);
+   assert(name != NULL);
+   assert(pHistogram != NULL);
+
+   fprintf(stream, "%-24s count=%lu mean=%luns", name,
+           (unsigned long) pHistogram->count,
+           (unsigned long) (pHistogram->totalNs / pHistogram->count));
+   for(q = 0; q < NUM_DUMP_QUANTILES; q++)
+      fprintf(stream, " %s=%luns", dumpLabels[q],
+              (unsigned long) Stats_percentile(pHistogram,
+                                               dumpQuantiles[q]));
+   fprintf(stream, " max=%luns\n", (unsigned long) pHistogram->maxNs);
+}
+
+/* Writes the latencies in *pHistogram of the FT entry point named
+   name to stream as one member of a JSON object. */
+static void Stats_dumpJSON(FILE* stream, const char* name,
+                           const struct Stats_histogram* pHistogram) {
+   size_t q;
+   size_t b;
+   boolean isFirst = TRUE;
+
+   assert(stream != NULL);
+   assert(name != NULL);
+   assert(pHistogram != NULL);
+
+   fprintf(stream, "  \"%s\": {\"count\": %lu, \"mean_ns\": %lu", name,
+           (unsigned long) pHistogram->count,
+           (unsigned long) (pHistogram->totalNs / pHistogram->count));
+   for(q = 0; q < NUM_DUMP_QUANTILES; q++)
+      fprintf(stream, ", \"%s_ns\": %lu", dumpLabels[q],
+              (unsigned long) Stats_percentile(pHistogram,
+                                               dumpQuantiles[q]));
+   fprintf(stream, ", \"max_ns\": %lu, \"buckets\": [",
+           (unsigned long) pHistogram->maxNs);
+   for(b = 0; b < STATS_NUM_BUCKETS; b++) {
+      if(pHistogram->buckets[b] == 0)
+         continue;
+      fprintf(stream, "%s[%lu, %lu]", isFirst ? "" : ", ",
+              (unsigned long) Stats_bucketTop(b),
+              (unsigned long) pHistogram->buckets[b]);
+      isFirst = FALSE;
+   }
+   fprintf(stream, "]}");
+}
+
+/* see stats.h for specification */
+void Stats_dumpLatency(FILE* stream, boolean asJSON) {
+   struct Stats_histogram histogram;
+   size_t op;
+   boolean isFirst = TRUE;
+
+   assert(stream != NULL);
+
+   if(asJSON)
+      fprintf(stream, "{");
+   for(op = 0; op < FT_NUM_OPS; op++) {
+      Stats_readLatency((enum FT_op) op, &histogram);
+      if(histogram.count == 0)
+         continue;
+      if(asJSON) {
+         fprintf(stream, "%s\n", isFirst ? "" : ",");
+         Stats_dumpJSON(stream, opNames[op], &histogram);
+      }
+      else
+         Stats_dumpText(stream, opNames[op], &histogram);
+      isFirst = FALSE;
+   }
+   if(asJSON)
+      fprintf(stream, "\n}\n");
+}
@@ -0,0 +1,169 @@
+/*--------------------------------------------------------------------*/
+/* stats.h                                                            */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef STATS_INCLUDED
+#define STATS_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+#include "ft.h"
+
+/*
+   The statistics module keeps one struct FT_stats of counters per
+   thread, so that counting on the hot paths never contends on a
+   shared cache line. Readers aggregate the counters of every thread
+   (including threads that have since exited) on demand.
+
+   Each thread also keeps a latency histogram per FT entry point.
+   The histograms are log-bucketed in the style of HdrHistogram: every
+   power of two of nanoseconds is split into STATS_SUB_BUCKETS linear
+   sub-buckets, so any recorded latency is reported within about 6%.
+
+   Compiling with -DNSTATS removes every counter update, in the same
+   way that -DNDEBUG removes assertions; Stats_read then reports all
+   zeros.
+*/
+
+/* The number of linear sub-buckets per power of two, as a shift. */
+enum { STATS_SUB_BUCKET_BITS = 4 };
+enum { STATS_SUB_BUCKETS = 1 << STATS_SUB_BUCKET_BITS };
+
+/* The highest power of two of ns that gets its own buckets; longer
+   latencies (over about 36 minutes) share the last bucket. */
+enum { STATS_MAX_EXPONENT = 40 };
+
+/* The number of buckets in one latency histogram: one row of
+   sub-buckets for the exact values below STATS_SUB_BUCKETS, and one
+   per power of two from there up to STATS_MAX_EXPONENT. */
+enum { STATS_NUM_BUCKETS =
+          (STATS_MAX_EXPONENT - STATS_SUB_BUCKET_BITS + 2)
+          * STATS_SUB_BUCKETS };
+
+/* The latencies recorded for one FT entry point. */
+struct Stats_histogram {
+   /* the number of latencies recorded in each bucket */
+   size_t buckets[STATS_NUM_BUCKETS];
+   /* the number of latencies recorded */
+   size_t count;
+   /* the sum of the latencies recorded, in ns */
+   size_t totalNs;
+   /* the largest latency recorded, in ns */
+   size_t maxNs;
+};
+
+#ifdef NSTATS
+
+#define STATS_ADD(field, n) ((void) 0)
+#define STATS_OP_BEGIN(op) ((void) 0)
+#define STATS_OP_END(op) ((void) 0)
+
+#else
+
+/* The counters of one thread, and its link in the list of all
+   threads' counters. */
+struct Stats_local {
+   /* TRUE once this thread's counters are visible to readers */
+   int isRegistered;
+   /* the counters themselves */
+   struct FT_stats stats;
+   /* the latencies of each FT entry point */
+   struct Stats_histogram latency[FT_NUM_OPS];
+   /* when the FT entry point in progress was called, in ns */
+   size_t opStart;
+   /* the next thread's counters */
+   struct Stats_local* next;
+};
+
+/* The counters of the calling thread. */
+extern __thread struct Stats_local Stats_tls;
+
+/*
+  Makes the calling thread's counters visible to Stats_read.
+  Returns 1 so that it can be used inside an expression.
+*/
+int Stats_register(void);
+
+/*
+  Adds n to counter, a size_t of the calling thread's counters. Only
+  the thread itself adds to its counters, but Stats_read and
+  Stats_reset read and clear them from other threads, so counter is
+  loaded and stored atomically. The add as a whole is not atomic,
+  which costs nothing over a plain add on common processors.
+*/
+#define STATS_BUMP(counter, n) \
+   __atomic_store_n(&(counter), \
+                    __atomic_load_n(&(counter), __ATOMIC_RELAXED) \
+                    + (n), __ATOMIC_RELAXED)
+
+/*
+  Adds n to the calling thread's counter field, a member designator
+  of struct FT_stats such as nodeCompares or calls[FT_OP_STAT].
+*/
+#define STATS_ADD(field, n) \
+   ((void) (Stats_tls.isRegistered || Stats_register()), \
+    STATS_BUMP(Stats_tls.stats.field, n))
+
+/*
+  Returns the current time of a monotonic clock, in ns.
+*/
+size_t Stats_now(void);
+
+/*
+  Adds latencyNs to the calling thread's histogram for FT entry
+  point op.
+*/
+void Stats_recordLatency(enum FT_op op, size_t latencyNs);
+
+/*
+  Counts a call to FT entry point op and starts timing it. FT entry
+  points do not call each other, so one start time per thread is
+  enough.
+*/
+#define STATS_OP_BEGIN(op) \
+   (STATS_ADD(calls[op], 1), (void) (Stats_tls.opStart = Stats_now()))
+
+/*
+  Records the latency of the call to FT entry point op that
+  STATS_OP_BEGIN started timing.
+*/
+#define STATS_OP_END(op) \
+   Stats_recordLatency(op, Stats_now() - Stats_tls.opStart)
+
+#endif
+
+/*
+  Stores the sum of every thread's counters in *pStats.
+*/
+void Stats_read(struct FT_stats* pStats);
+
+/*
+  Stores the sum of every thread's latency histogram for FT entry
+  point op in *pHistogram.
+*/
+void Stats_readLatency(enum FT_op op,
+                       struct Stats_histogram* pHistogram);
+
+/*
+  Returns the latency, in ns, below which the fraction quantile
+  (between 0 and 1) of the latencies in *pHistogram fall, rounded up
+  to the top of its bucket. Returns 0 for an empty histogram.
+*/
+size_t Stats_percentile(const struct Stats_histogram* pHistogram,
+                        double quantile);
+
+/*
+  Writes the count, mean and p50/p90/p99/p99.9/max latency of every
+  FT entry point that has been called to stream, as one line of text
+  per entry point, or as a JSON object (which also lists the non-empty
+  buckets) if asJSON is TRUE.
+*/
+void Stats_dumpLatency(FILE* stream, boolean asJSON);
+
+/*
+  Sets every thread's counters and histograms back to zero.
+*/
+void Stats_reset(void);
+
+#endif
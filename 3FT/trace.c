@@ -0,0 +1,311 @@
+/*--------------------------------------------------------------------*/
+/* trace.c                                                            */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+/* The bytes that every trace starts with. */
+static const char traceMagic[] = "FTTRACE1";
+enum { MAGIC_LENGTH = 8 };
+
+/* The most bytes that a varint of a size_t takes. */
+enum { MAX_VARINT = (sizeof(size_t) * 8 + 6) / 7 };
+
+/* The number of bytes read from a trace file at a time. */
+enum { READ_CHUNK = 1 << 16 };
+
+/* A trace is its records, whose paths point into one block. */
+struct trace {
+   /* the records, in the order the calls returned */
+   struct Trace_record* records;
+   /* the number of records */
+   size_t length;
+   /* the '\0'-terminated paths of every record, one after another */
+   char* paths;
+};
+
+/* see trace.h for specification */
+FILE* Trace_stream = NULL;
+
+/* Serializes the writers of records to Trace_stream. */
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* When the previous record was written, in ns. */
+static size_t lastNs;
+
+/* Returns the current time of a monotonic clock, in ns. */
+static size_t Trace_now(void) {
+   struct timespec now;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+   return (size_t) now.tv_sec * 1000000000 + (size_t) now.tv_nsec;
+}
+
+/* Writes value as a varint to buf, and returns the number of bytes
+   written, at most MAX_VARINT. */
+static size_t Trace_putVarint(unsigned char* buf, size_t value) {
+   size_t used = 0;
+
+   while(value >= 0x80) {
+      buf[used++] = (unsigned char) (value | 0x80);
+      value >>= 7;
+   }
+   buf[used++] = (unsigned char) value;
+   return used;
+}
+
+/* Reads a varint from the bytes from *pNext up to end into *pValue,
+   and advances *pNext past it. Returns TRUE, or FALSE if the varint
+   runs past end or does not fit in a size_t. */
+static boolean Trace_getVarint(const unsigned char** pNext,
+                               const unsigned char* end,
+                               size_t* pValue) {
+   size_t shift = 0;
+   unsigned char byte;
+
+   *pValue = 0;
+   do {
+      if(*pNext == end || shift >= sizeof(size_t) * 8)
+         return FALSE;
+      byte = *(*pNext)++;
+      *pValue |= (size_t) (byte & 0x7f) << shift;
+      shift += 7;
+   } while(byte & 0x80);
+   return TRUE;
+}
+
+/* see trace.h for specification */
+int Trace_start(FILE* stream) {
+   int result;
+
+   assert(stream != NULL);
+
+   (void) pthread_mutex_lock(&traceLock);
+   if(Trace_stream != NULL)
+      result = INITIALIZATION_ERROR;
+   else {
+      (void) fwrite(traceMagic, 1, MAGIC_LENGTH, stream);
+      lastNs = Trace_now();
+      __atomic_store_n(&Trace_stream, stream, __ATOMIC_RELAXED);
+      result = SUCCESS;
+   }
+   (void) pthread_mutex_unlock(&traceLock);
+   return result;
+}
+
+/* see trace.h for specification */
+int Trace_stop(void) {
+   int result;
+
+   (void) pthread_mutex_lock(&traceLock);
+   if(Trace_stream == NULL)
+      result = INITIALIZATION_ERROR;
+   else {
+      (void) fflush(Trace_stream);
+      __atomic_store_n(&Trace_stream, NULL, __ATOMIC_RELAXED);
+      result = SUCCESS;
+   }
+   (void) pthread_mutex_unlock(&traceLock);
+   return result;
+}
+
+/* see trace.h for specification */
+void Trace_record(enum FT_op op, const char* path, size_t pathLength,
+                  size_t length, int result) {
+   unsigned char head[2 + 3 * MAX_VARINT];
+   size_t used = 0;
+   size_t now;
+
+   assert((int) op >= 0 && op < FT_NUM_OPS);
+   assert(path != NULL || pathLength == 0);
+
+   (void) pthread_mutex_lock(&traceLock);
+   /* recheck now that no one can stop the trace under us */
+   if(Trace_stream != NULL) {
+      now = Trace_now();
+      head[used++] = (unsigned char) op;
+      head[used++] = (unsigned char) result;
+      used += Trace_putVarint(head + used, now - lastNs);
+      used += Trace_putVarint(head + used, length);
+      used += Trace_putVarint(head + used, pathLength);
+      (void) fwrite(head, 1, used, Trace_stream);
+      if(pathLength != 0)
+         (void) fwrite(path, 1, pathLength, Trace_stream);
+      lastNs = now;
+   }
+   (void) pthread_mutex_unlock(&traceLock);
+}
+
+/*
+   Returns the whole contents of stream in a new buffer owned by the
+   caller, storing its length in *pLength, or NULL if there is not
+   enough memory or a read error occurs.
+*/
+static unsigned char* Trace_readAll(FILE* stream, size_t* pLength) {
+   unsigned char* bytes = NULL;
+   unsigned char* grown;
+   size_t used = 0;
+   size_t capacity = 0;
+   size_t got;
+
+   assert(stream != NULL);
+   assert(pLength != NULL);
+
+   do {
+      if(capacity - used < READ_CHUNK) {
+         capacity = capacity * 2 + READ_CHUNK;
+         grown = realloc(bytes, capacity);
+         if(grown == NULL) {
+            free(bytes);
+            return NULL;
+         }
+         bytes = grown;
+      }
+      got = fread(bytes + used, 1, READ_CHUNK, stream);
+      used += got;
+   } while(got == READ_CHUNK);
+
+   if(ferror(stream)) {
+      free(bytes);
+      return NULL;
+   }
+   *pLength = used;
+   return bytes;
+}
+
+/*
+   Decodes the records in the bytes from next up to end. If oTrace's
+   records are NULL, only counts them, storing the number of records
+   in oTrace->length and the bytes that their paths need in
+   *pPathBytes; otherwise also fills in the records and their paths.
+   Returns TRUE, or FALSE if a record is malformed or truncated.
+*/
+static boolean Trace_decode(const unsigned char* next,
+                            const unsigned char* end,
+                            Trace_T oTrace, size_t* pPathBytes) {
+   struct Trace_record record;
+   size_t timeNs = 0;
+   size_t delta;
+   size_t pathLength;
+
+   oTrace->length = 0;
+   *pPathBytes = 0;
+   while(next != end) {
+      if(end - next < 2 || *next >= FT_NUM_OPS)
+         return FALSE;
+      record.op = (enum FT_op) *next++;
+      record.result = *next++;
+      if(!Trace_getVarint(&next, end, &delta) ||
+         !Trace_getVarint(&next, end, &record.length) ||
+         !Trace_getVarint(&next, end, &pathLength) ||
+         (size_t) (end - next) < pathLength)
+         return FALSE;
+      timeNs += delta;
+      record.timeNs = timeNs;
+
+      if(oTrace->records != NULL) {
+         record.path = oTrace->paths + *pPathBytes;
+         memcpy(record.path, next, pathLength);
+         record.path[pathLength] = '\0';
+         oTrace->records[oTrace->length] = record;
+      }
+      next += pathLength;
+      *pPathBytes += pathLength + 1;
+      oTrace->length++;
+   }
+   return TRUE;
+}
+
+/* see trace.h for specification */
+Trace_T Trace_load(const char* filename) {
+   Trace_T oTrace;
+   FILE* stream;
+   unsigned char* bytes;
+   size_t length;
+   size_t pathBytes;
+
+   assert(filename != NULL);
+
+   stream = fopen(filename, "rb");
+   if(stream == NULL) {
+      fprintf(stderr, "%s: cannot open\n", filename);
+      return NULL;
+   }
+   bytes = Trace_readAll(stream, &length);
+   (void) fclose(stream);
+   if(bytes == NULL) {
+      fprintf(stderr, "%s: cannot read\n", filename);
+      return NULL;
+   }
+   if(length < MAGIC_LENGTH ||
+      memcmp(bytes, traceMagic, MAGIC_LENGTH)) {
+      free(bytes);
+      fprintf(stderr, "%s: not a trace\n", filename);
+      return NULL;
+   }
+
+   oTrace = malloc(sizeof(struct trace));
+   if(oTrace == NULL) {
+      free(bytes);
+      fprintf(stderr, "%s: out of memory\n", filename);
+      return NULL;
+   }
+   oTrace->records = NULL;
+   oTrace->paths = NULL;
+   if(!Trace_decode(bytes + MAGIC_LENGTH, bytes + length, oTrace,
+                    &pathBytes)) {
+      free(bytes);
+      free(oTrace);
+      fprintf(stderr, "%s: truncated or malformed record\n", filename);
+      return NULL;
+   }
+
+   oTrace->records = malloc((oTrace->length + 1)
+                            * sizeof(struct Trace_record));
+   oTrace->paths = malloc(pathBytes + 1);
+   if(oTrace->records == NULL || oTrace->paths == NULL) {
+      free(bytes);
+      Trace_free(oTrace);
+      fprintf(stderr, "%s: out of memory\n", filename);
+      return NULL;
+   }
+   (void) Trace_decode(bytes + MAGIC_LENGTH, bytes + length, oTrace,
+                       &pathBytes);
+
+   free(bytes);
+   return oTrace;
+}
+
+/* see trace.h for specification */
+void Trace_free(Trace_T oTrace) {
+   assert(oTrace != NULL);
+
+   free(oTrace->records);
+   free(oTrace->paths);
+   free(oTrace);
+}
+
+/* see trace.h for specification */
+size_t Trace_getLength(Trace_T oTrace) {
+   assert(oTrace != NULL);
+
+   return oTrace->length;
+}
+
+/* see trace.h for specification */
+const struct Trace_record* Trace_get(Trace_T oTrace, size_t recordID) {
+   assert(oTrace != NULL);
+   assert(recordID < oTrace->length);
+
+   return &oTrace->records[recordID];
+}
@@ -0,0 +1,131 @@
+/*--------------------------------------------------------------------*/
+/* trace.h                                                            */
+/* Author(s): Alex Baroody and Austen Mazenko                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef TRACE_INCLUDED
+#define TRACE_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+#include "ft.h"
+
+/*
+   The trace module records the calls to the FT entry points, while a
+   client has asked for it with FT_startTrace, to a compact binary
+   trace that ft_replay can play back. A trace is the 8 bytes
+   "FTTRACE1" followed by one record per call, in the order in which
+   the calls returned:
+
+      1 byte    the entry point, an enum FT_op
+      1 byte    the result: the status returned, TRUE or FALSE for
+                FT_containsDir and FT_containsFile, and SUCCESS or
+                another status for the entry points that return a
+                pointer
+      varint    the ns since the previous call returned (or since the
+                trace started, for the first call)
+      varint    the content length passed to FT_insertFile,
+                FT_replaceFileContents or FT_upsertFile or reported
+                by FT_stat, or 0
+      varint    the length of the path, or 0 for the entry points
+                that take none
+      bytes     the path, without its '\0'
+
+   A varint is an unsigned number stored 7 bits per byte, least
+   significant first, with the high bit set on every byte but the
+   last. Contents themselves are not recorded. FT_statMany and
+   FT_statBatch record one FT_OP_STAT per path, in the order they
+   look them up, and FT_insertFileAt, FT_statAt and
+   FT_getFileContentsById record the FT_insertFile, FT_stat or
+   FT_getFileContents on the whole path that they stand for, so that
+   a trace holds only calls that take a single path. FT_open, FT_close
+   and FT_listAt, which change no Node, are not recorded.
+*/
+
+/* One recorded call. */
+struct Trace_record {
+   /* the entry point called */
+   enum FT_op op;
+   /* what it returned, as described above */
+   int result;
+   /* when it returned, in ns since the trace started */
+   size_t timeNs;
+   /* the content length, or 0 */
+   size_t length;
+   /* the path, '\0'-terminated, or "" for none */
+   char* path;
+};
+
+/* A trace loaded into memory. */
+typedef struct trace* Trace_T;
+
+/* The stream that calls are being recorded to, or NULL if none. It is
+   only changed with atomic stores, under the lock that Trace_record
+   takes, so that threads may test it without the lock, with
+   TRACE_IS_ON, while another starts or stops the trace. */
+extern FILE* Trace_stream;
+
+/*
+  Starts recording calls to stream, which must be open for binary
+  writing and stays owned by the caller, by writing the header of a
+  trace to it. Returns SUCCESS, or INITIALIZATION_ERROR if calls are
+  already being recorded.
+*/
+int Trace_start(FILE* stream);
+
+/*
+  Stops recording calls and flushes the stream they were recorded to.
+  Returns SUCCESS, or INITIALIZATION_ERROR if calls were not being
+  recorded.
+*/
+int Trace_stop(void);
+
+/*
+  Appends a record of a call to entry point op with the pathLength
+  bytes at path as its path (path may be NULL if pathLength is 0) and
+  content length length that returned result. Safe to call from
+  several threads at once.
+*/
+void Trace_record(enum FT_op op, const char* path, size_t pathLength,
+                  size_t length, int result);
+
+/*
+  Evaluates to nonzero if calls are being recorded. The answer may be
+  out of date by the time it is acted on, which is harmless, because
+  Trace_record checks again under its lock.
+*/
+#define TRACE_IS_ON() \
+   (__atomic_load_n(&Trace_stream, __ATOMIC_RELAXED) != NULL)
+
+/*
+  Records a call, as Trace_record does, if calls are being recorded.
+  Costs one test of Trace_stream otherwise.
+*/
+#define TRACE_RECORD(op, path, pathLength, length, result) \
+   ((void) (!TRACE_IS_ON() || \
+            (Trace_record(op, path, pathLength, length, result), 0)))
+
+/*
+  Reads the trace in the file named filename into memory. Returns it,
+  or NULL (after writing why to stderr) if the file cannot be read,
+  is not a trace, is truncated, or there is not enough memory.
+*/
+Trace_T Trace_load(const char* filename);
+
+/*
+  Frees oTrace and every record in it.
+*/
+void Trace_free(Trace_T oTrace);
+
+/*
+  Returns the number of records in oTrace.
+*/
+size_t Trace_getLength(Trace_T oTrace);
+
+/*
+  Returns the record of oTrace with index recordID, which must be less
+  than Trace_getLength(oTrace).
+*/
+const struct Trace_record* Trace_get(Trace_T oTrace, size_t recordID);
+
+#endif